@@ -1,13 +1,19 @@
 #!/bin/bash
 set -e
 
-echo "Downloading neural network files..."
-(cd src && ../scripts/net.sh)
+if [ -x src/stockfish-x86-64 ]; then
+    # Image built with DISPATCH_BUILD=true: src/stockfish picks the best prebuilt
+    # variant for this CPU at startup, nothing to compile.
+    echo "Using prebuilt Stockfish ($(./src/stockfish --dispatch-arch))..."
+else
+    echo "Downloading neural network files..."
+    (cd src && ../scripts/net.sh)
 
-echo "Building Stockfish with native optimizations for this system..."
-# The 'profile-build' target uses profile-guided optimization for best performance
-# and automatically detects the host architecture.
-(cd src && make -j$(nproc) profile-build)
+    echo "Building Stockfish with native optimizations for this system..."
+    # The 'profile-build' target uses profile-guided optimization for best performance
+    # and automatically detects the host architecture.
+    (cd src && make -j$(nproc) profile-build)
+fi
 
 
 echo "Build complete. Starting Stockfish..."
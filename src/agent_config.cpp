@@ -98,12 +98,58 @@ AgentConfig AgentConfig::load(int argc, char* argv[]) {
     config.skill_level = std::atoi(get("SKILL_LEVEL", "20").c_str());
     config.limit_strength = to_bool(get("LIMIT_STRENGTH", "false"));
     config.elo = std::atoi(get("ELO", "1350").c_str());
+    config.skill_rescore = to_bool(get("SKILL_RESCORE", "false"));
 
     // Engine performance options
     config.hash = std::atoi(get("HASH", "16").c_str());
     config.ponder = to_bool(get("PONDER", "false"));
     config.multi_pv = std::atoi(get("MULTI_PV", "1").c_str());
     config.threads = std::atoi(get("THREADS", "1").c_str());
+    config.thread_placement = get("THREAD_PLACEMENT", "numa");
+    std::transform(config.thread_placement.begin(), config.thread_placement.end(),
+                   config.thread_placement.begin(), ::tolower);
+    if (config.thread_placement != "numa" && config.thread_placement != "cores"
+        && config.thread_placement != "siblings") {
+        std::cerr << "Error: THREAD_PLACEMENT must be numa, cores or siblings" << std::endl;
+        exit(1);
+    }
+    config.reserved_cores = std::atoi(get("RESERVED_CORES", "0").c_str());
+    config.exclusive_cores = to_bool(get("EXCLUSIVE_CORES", "false"));
+    // Must be the same directory for all the agents of the host, a volume mounted
+    // in every container when they run in containers
+    config.core_lock_dir = get("CORE_LOCK_DIR", "/tmp");
+    config.eval_cache = to_bool(get("EVAL_CACHE", "false"));
+    config.tt_front = to_bool(get("TT_FRONT", "false"));
+    config.vector_move_picker = to_bool(get("VECTOR_MOVE_PICKER", "false"));
+    config.tt_prefetch_ahead = std::atoi(get("TT_PREFETCH_AHEAD", "0").c_str());
+    config.compact_history = to_bool(get("COMPACT_HISTORY", "false"));
+    config.shared_history = to_bool(get("SHARED_HISTORY", "false"));
+
+    // Directory of the preprocessed network cache shared by all agents on the host.
+    // Empty disables the cache and every start parses the network files.
+    config.nnue_cache_dir = get("NNUE_CACHE_DIR", "");
+
+    // Syzygy tablebases, disabled unless a path is given
+    config.syzygy_path = get("SYZYGY_PATH", "");
+    config.syzygy_warmup = to_bool(get("SYZYGY_WARMUP", "false"));
+    config.syzygy_pin = to_bool(get("SYZYGY_PIN", "false"));
+    config.syzygy_probe_cache = to_bool(get("SYZYGY_PROBE_CACHE", "false"));
+
+    // Logging
+    std::string log_level = get("LOG_LEVEL", "info");
+    std::string log_format = get("LOG_FORMAT", "text");
+    std::transform(log_level.begin(), log_level.end(), log_level.begin(), ::tolower);
+    std::transform(log_format.begin(), log_format.end(), log_format.begin(), ::tolower);
+    if (!log_level_from_string(log_level) || !log_format_from_string(log_format)) {
+        std::cerr << "Error: LOG_LEVEL must be debug, info, warning, error or off, "
+                  << "and LOG_FORMAT text or json" << std::endl;
+        exit(1);
+    }
+    config.log_level = *log_level_from_string(log_level);
+    config.log_format = *log_format_from_string(log_format);
+
+    // Hash table report after each move, to size HASH per time control
+    config.tt_stats = to_bool(get("TT_STATS", "false"));
 
     // Defensive Time Management
     // Default to 1.0 (100%) if not set. Recommended for Blitz 5+0: 0.90 or 0.95
@@ -113,6 +159,20 @@ AgentConfig AgentConfig::load(int argc, char* argv[]) {
     // Default to 0ms. Recommended for Blitz 5+0: 100 or 500 to account for network/GC lags
     config.time_safety_margin_ms = std::atoi(get("TIME_SAFETY_MARGIN_MS", "0").c_str());
 
+    // Table of the time allocation model, see --bench timefit. Empty keeps the formulas.
+    config.time_model = get("TIME_MODEL", "");
+
+    // Last line of defence against stalls the time manager cannot see
+    config.deadline_watchdog = to_bool(get("DEADLINE_WATCHDOG", "true"));
+    config.deadline_margin_ms = std::atoi(get("DEADLINE_MARGIN_MS", "50").c_str());
+
+    // Analysis service for local tooling, disabled by default
+    config.analysis_port = std::atoi(get("ANALYSIS_PORT", "0").c_str());
+    config.analysis_engines = std::atoi(get("ANALYSIS_ENGINES", "1").c_str());
+    config.analysis_threads = std::atoi(get("ANALYSIS_THREADS", "1").c_str());
+    config.analysis_hash = std::atoi(get("ANALYSIS_HASH", "16").c_str());
+    config.analysis_queue = std::atoi(get("ANALYSIS_QUEUE", "64").c_str());
+
     // Initialize provisioner mode fields with defaults
     config.provisioner_mode = false;
     config.target_game_id = "";
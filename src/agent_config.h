@@ -3,6 +3,8 @@
 
 #include <string>
 
+#include "misc.h"
+
 namespace Stockfish {
 
 struct AgentConfig {
@@ -20,14 +22,47 @@ struct AgentConfig {
     int skill_level;
     bool limit_strength;
     int elo;
+    bool skill_rescore; // weaken without a MultiPV search
     int hash;
     bool ponder;
     int multi_pv;
     int threads;
+    std::string thread_placement; // numa, cores or siblings
+    int reserved_cores; // physical cores left free of search threads
+    bool exclusive_cores; // avoid the cores used by other agents
+    std::string core_lock_dir; // lock files of exclusive_cores, shared by the agents
+    bool eval_cache; // per-thread cache of network outputs
+    bool tt_front; // per-thread table of recent shallow hash entries, probed first
+    bool vector_move_picker; // vectorized move scoring and selection
+    int tt_prefetch_ahead; // moves whose hash entries are prefetched early, 0 to 2
+    bool compact_history; // smaller per-thread history tables
+    bool shared_history; // histories shared by the threads of a NUMA node
+    std::string nnue_cache_dir; // preprocessed network cache, empty to disable
+    std::string syzygy_path; // tablebase directories, empty to disable
+    bool syzygy_warmup; // read the reachable tables ahead of the search
+    bool syzygy_pin; // lock the warmed tables in memory
+    bool syzygy_probe_cache; // cache of tablebase probe results
+
+    // Output of the agent, written by a background thread
+    LogLevel log_level;
+    LogFormat log_format;
+    bool tt_stats; // hash table contents and usage after each move
 
     // Defensive time management settings
     double time_usage_multiplier; // e.g., 0.9 to use only 90% of available time
     int time_safety_margin_ms;    // e.g., 500 to reserve 500ms as buffer
+    std::string time_model;       // fitted time allocation table, empty for the formulas
+
+    // Plays the best move so far when the search has not returned this close to the flag
+    bool deadline_watchdog = true;
+    int deadline_margin_ms = 50;
+
+    // Local analysis service, see analysis.proto
+    int analysis_port; // 0 to disable
+    int analysis_engines; // engines serving the requests in parallel
+    int analysis_threads; // search threads per engine
+    int analysis_hash; // MB per engine
+    int analysis_queue; // requests waiting for an engine before rejecting
 
     // Provisioner mode settings
     bool provisioner_mode;
@@ -0,0 +1,469 @@
+#include "analysis_service.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <iterator>
+#include <sstream>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "misc.h"
+#include "move_conversion.h"
+#include "position.h"
+#include "score.h"
+
+namespace Stockfish {
+
+namespace {
+const std::string StartFEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// Handler wake-ups to notice a cancelled call while the search is quiet
+constexpr int PollMs = 50;
+
+std::string bool_option(bool b) { return b ? "true" : "false"; }
+
+analysis::AnalysisUpdate pv_update(const Engine::InfoFull& info) {
+    analysis::AnalysisUpdate update;
+    auto* line = update.mutable_pv();
+
+    line->set_depth(info.depth);
+    line->set_sel_depth(info.selDepth);
+    line->set_multi_pv(int(info.multiPV));
+    info.score.visit([&](const auto& s) {
+        using T = std::decay_t<decltype(s)>;
+        if constexpr (std::is_same_v<T, Score::Mate>)
+            line->set_mate(s.plies > 0 ? (s.plies + 1) / 2 : s.plies / 2);
+        else if constexpr (std::is_same_v<T, Score::Tablebase>)
+            line->set_cp(s.win ? 20000 - s.plies : -20000 - s.plies);
+        else
+            line->set_cp(s.value);
+    });
+    line->set_bound(std::string(info.bound));
+    line->set_nodes(info.nodes);
+    line->set_nps(info.nps);
+    line->set_time_ms(info.timeMs);
+    line->set_tb_hits(info.tbHits);
+    line->set_hashfull(info.hashfull);
+
+    std::istringstream pv{std::string(info.pv)};
+    for (std::string move; pv >> move;)
+        line->add_pv(move);
+
+    return update;
+}
+
+// Returns why the FEN is not a position that can be searched, or an empty string.
+// Position::set() trusts its input: without a king, or with a castling right
+// without its rook, it would crash the engine instead of failing the call.
+std::string invalid_fen(const std::string& fen) {
+    std::istringstream ss(fen);
+    std::string board, side, castling = "-", ep = "-", rule50 = "0", fullmove = "1", extra;
+    ss >> board >> side >> castling >> ep >> rule50 >> fullmove;
+
+    if (side.empty() || (ss >> extra)) {
+        return "expected 2 to 6 fields";
+    }
+
+    // [rank][file], from the 8th rank down as in the FEN
+    char squares[8][8] = {};
+    int rank = 0, file = 0;
+    for (char c : board) {
+        if (c == '/') {
+            if (file != 8 || ++rank > 7) {
+                return "the board must have 8 ranks of 8 files";
+            }
+            file = 0;
+        } else if (c >= '1' && c <= '8') {
+            file += c - '0';
+        } else if (std::string_view("PNBRQKpnbrqk").find(c) != std::string_view::npos) {
+            if (file < 8) {
+                squares[rank][file] = c;
+            }
+            ++file;
+        } else {
+            return std::string("unknown piece '") + c + "'";
+        }
+
+        if (file > 8) {
+            return "the board must have 8 ranks of 8 files";
+        }
+    }
+    if (rank != 7 || file != 8) {
+        return "the board must have 8 ranks of 8 files";
+    }
+
+    auto count = [&](char piece) {
+        int n = 0;
+        for (const auto& row : squares) {
+            n += int(std::count(std::begin(row), std::end(row), piece));
+        }
+        return n;
+    };
+
+    if (count('K') != 1 || count('k') != 1) {
+        return "each side must have one king";
+    }
+
+    for (int f = 0; f < 8; ++f) {
+        if (std::toupper(squares[0][f]) == 'P' || std::toupper(squares[7][f]) == 'P') {
+            return "pawns on the first or last rank";
+        }
+    }
+
+    // The pieces beyond the initial ones are promoted pawns
+    for (const char* pieces : {"PNBRQ", "pnbrq"}) {
+        int promoted = std::max(count(pieces[1]) - 2, 0) + std::max(count(pieces[2]) - 2, 0)
+                     + std::max(count(pieces[3]) - 2, 0) + std::max(count(pieces[4]) - 1, 0);
+        if (count(pieces[0]) + promoted > 8) {
+            return "too many pieces";
+        }
+    }
+
+    if (side != "w" && side != "b") {
+        return "the side to move must be w or b";
+    }
+
+    // Only the standard castling rights, with the king and the rook on their squares
+    if (castling != "-") {
+        for (size_t i = 0; i < castling.size(); ++i) {
+            char c = castling[i];
+            if (std::string_view("KQkq").find(c) == std::string_view::npos
+                || castling.find(c, i + 1) != std::string::npos) {
+                return "bad castling field";
+            }
+
+            bool white = c == 'K' || c == 'Q';
+            int  r = white ? 7 : 0, f = c == 'K' || c == 'k' ? 7 : 0;
+            if (squares[r][4] != (white ? 'K' : 'k') || squares[r][f] != (white ? 'R' : 'r')) {
+                return std::string("castling right ") + c + " without the king and rook in place";
+            }
+        }
+    }
+
+    if (ep != "-"
+        && (ep.size() != 2 || ep[0] < 'a' || ep[0] > 'h' || ep[1] != (side == "w" ? '6' : '3'))) {
+        return "bad en passant field";
+    }
+
+    auto number = [](const std::string& str) {
+        return !str.empty() && str.size() <= 4
+            && std::all_of(str.begin(), str.end(), [](char c) { return c >= '0' && c <= '9'; });
+    };
+    if (!number(rule50) || !number(fullmove)) {
+        return "bad move counters";
+    }
+
+    // Safe to set up now
+    StateInfo st;
+    Position  pos;
+    pos.set(fen, false, &st);
+
+    Color us = pos.side_to_move();
+    if (pos.attackers_to(pos.square<KING>(~us)) & pos.pieces(us)) {
+        return "the side not to move is in check";
+    }
+
+    return "";
+}
+
+// Returns the first move that is not legal, or an empty string
+std::string illegal_move(const std::string& fen, const std::vector<std::string>& moves) {
+    StateListPtr states = make_state_list();
+    Position     pos;
+    pos.set(fen, false, &states->back());
+
+    for (const auto& move : moves) {
+        Move m = to_move(pos, move);
+        if (m == Move::none())
+            return move;
+
+        states->emplace_back();
+        pos.do_move(m, states->back());
+    }
+
+    return "";
+}
+}
+
+bool AnalysisJob::is_short() const {
+    return (limits.depth && limits.depth <= ShortDepth) || (limits.nodes && limits.nodes <= ShortNodes)
+        || (limits.movetime && limits.movetime <= ShortTimeMs);
+}
+
+void AnalysisJob::push(analysis::AnalysisUpdate&& update) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (updates.size() >= MaxPendingUpdates) {
+            auto pv = std::find_if(updates.begin(), updates.end(),
+                                   [](const auto& u) { return !u.has_best_move(); });
+            if (pv != updates.end())
+                updates.erase(pv);
+        }
+        updates.push_back(std::move(update));
+    }
+    cv.notify_one();
+}
+
+void AnalysisJob::finish() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+    }
+    cv.notify_one();
+}
+
+bool AnalysisJob::wait(std::vector<analysis::AnalysisUpdate>& out, int timeoutMs) {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                [&]() { return done || !updates.empty(); });
+
+    for (auto& update : updates)
+        out.push_back(std::move(update));
+    updates.clear();
+
+    return !done || !out.empty();
+}
+
+AnalysisPool::AnalysisPool(const AgentConfig& config) :
+    capacity(std::max(config.analysis_queue, 1)) {
+
+    for (int i = 0; i < std::max(config.analysis_engines, 1); ++i) {
+        auto slot = std::make_unique<Slot>(config.nnue_cache_dir);
+        Engine& engine = slot->engine;
+        Slot* s = slot.get();
+
+        engine.get_options()["Threads"] = std::to_string(config.analysis_threads);
+        engine.get_options()["Hash"] = std::to_string(config.analysis_hash);
+        engine.get_options()["ThreadPlacement"] = config.thread_placement;
+        engine.get_options()["ExclusiveCores"] = bool_option(config.exclusive_cores);
+        engine.get_options()["CoreLockDir"] = config.core_lock_dir;
+        engine.get_options()["EvalCache"] = bool_option(config.eval_cache);
+        engine.get_options()["VectorMovePicker"] = bool_option(config.vector_move_picker);
+        engine.get_options()["TTPrefetchAhead"] = std::to_string(config.tt_prefetch_ahead);
+        engine.get_options()["TTFront"] = bool_option(config.tt_front);
+        engine.get_options()["CompactHistory"] = bool_option(config.compact_history);
+        engine.get_options()["SharedHistory"] = bool_option(config.shared_history);
+        engine.get_options()["SyzygyPath"] = config.syzygy_path;
+        engine.get_options()["SyzygyProbeCache"] = bool_option(config.syzygy_probe_cache);
+
+        engine.set_on_update_no_moves([](const Engine::InfoShort&) {});
+        engine.set_on_update_full([s](const Engine::InfoFull& info) {
+            s->job->push(pv_update(info));
+        });
+        engine.set_on_iter([s](const Engine::InfoIter& info) {
+            analysis::AnalysisUpdate update;
+            auto* current = update.mutable_current_move();
+            current->set_depth(info.depth);
+            current->set_move(std::string(info.currmove));
+            current->set_number(info.currmovenumber);
+            s->job->push(std::move(update));
+        });
+        engine.set_on_bestmove([s](std::string_view bestmove, std::string_view ponder) {
+            analysis::AnalysisUpdate update;
+            auto* best = update.mutable_best_move();
+            best->set_move(bestmove == "(none)" ? "" : std::string(bestmove));
+            best->set_ponder(std::string(ponder));
+            best->set_queued_ms(s->job->limits.startTime - s->job->queued);
+            s->job->push(std::move(update));
+        });
+        engine.set_on_verify_networks([](std::string_view msg) {
+            async_log(Debug) << "Analysis network verify: " << msg;
+        });
+
+        slots.push_back(std::move(slot));
+    }
+
+    for (auto& slot : slots)
+        slot->thread = std::thread([this, s = slot.get()]() { run(*s); });
+}
+
+AnalysisPool::~AnalysisPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        exit = true;
+
+        for (auto& job : queue) {
+            job->cancelled = true;
+            job->finish();
+        }
+        queue.clear();
+
+        for (auto& slot : slots)
+            slot->engine.stop();
+    }
+    cv.notify_all();
+
+    for (auto& slot : slots)
+        slot->thread.join();
+}
+
+bool AnalysisPool::submit(std::shared_ptr<AnalysisJob> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (exit || queue.size() >= capacity)
+            return false;
+
+        queue.push_back(std::move(job));
+    }
+    cv.notify_one();
+    return true;
+}
+
+void AnalysisPool::cancel(const std::shared_ptr<AnalysisJob>& job) {
+    job->cancelled = true;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (job->engine) {
+        job->engine->stop();
+    } else if (auto it = std::find(queue.begin(), queue.end(), job); it != queue.end()) {
+        queue.erase(it);
+        job->finish();
+    }
+}
+
+std::vector<std::shared_ptr<AnalysisJob>> AnalysisPool::take() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    ++idle;
+    cv.wait(lock, [&]() { return exit || !queue.empty(); });
+    --idle;
+
+    if (exit)
+        return {};
+
+    std::vector<std::shared_ptr<AnalysisJob>> jobs{queue.front()};
+    queue.pop_front();
+
+    if (!jobs[0]->is_short())
+        return jobs;
+
+    // Leave a share of the short jobs to each idle engine
+    std::size_t shortJobs = std::count_if(queue.begin(), queue.end(),
+                                          [](const auto& job) { return job->is_short(); });
+    std::size_t extra = std::min(BatchSize - 1, (shortJobs + idle) / (idle + 1));
+
+    for (auto it = queue.begin(); it != queue.end() && extra;) {
+        if ((*it)->is_short()) {
+            jobs.push_back(std::move(*it));
+            it = queue.erase(it);
+            --extra;
+        } else {
+            ++it;
+        }
+    }
+
+    return jobs;
+}
+
+void AnalysisPool::run(Slot& slot) {
+    for (auto jobs = take(); !jobs.empty(); jobs = take())
+        for (const auto& job : jobs)
+            run_job(slot, job);
+}
+
+void AnalysisPool::run_job(Slot& slot, const std::shared_ptr<AnalysisJob>& job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (exit || job->cancelled) {
+            job->finish();
+            return;
+        }
+        job->engine = &slot.engine;
+    }
+
+    slot.job = job;
+    slot.engine.get_options()["MultiPV"] = std::to_string(job->multiPV);
+    slot.engine.set_position(job->fen, job->moves);
+
+    job->limits.startTime = now();
+    slot.engine.go(job->limits);
+
+    // A stop between taking the job and starting the search would be lost
+    if (job->cancelled || exit)
+        slot.engine.stop();
+
+    slot.engine.wait_for_search_finished();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job->engine = nullptr;
+    }
+    slot.job.reset();
+    job->finish();
+}
+
+AnalysisService::AnalysisService(const AgentConfig& config) :
+    pool(config) {
+    std::string address = "127.0.0.1:" + std::to_string(config.analysis_port);
+
+    grpc::ServerBuilder builder;
+    builder.AddListeningPort(address, grpc::InsecureServerCredentials());
+    builder.RegisterService(this);
+    server = builder.BuildAndStart();
+
+    if (server) {
+        async_log(Info) << "Analysis service listening on " << address << ", "
+                        << config.analysis_engines << " engines of " << config.analysis_threads
+                        << " threads, queue of " << config.analysis_queue;
+    } else {
+        async_log(Error) << "Analysis service failed to listen on " << address;
+    }
+}
+
+AnalysisService::~AnalysisService() {
+    // Calls still streaming after the deadline are cancelled, which ends them
+    if (server) {
+        server->Shutdown(std::chrono::system_clock::now() + std::chrono::seconds(1));
+    }
+}
+
+grpc::Status AnalysisService::Analyse(grpc::ServerContext* context,
+                                      const analysis::AnalysisRequest* request,
+                                      grpc::ServerWriter<analysis::AnalysisUpdate>* writer) {
+    auto job = std::make_shared<AnalysisJob>();
+    job->fen = request->fen().empty() ? StartFEN : request->fen();
+    job->moves.assign(request->moves().begin(), request->moves().end());
+
+    if (std::string error = invalid_fen(job->fen); !error.empty()) {
+        return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Invalid FEN: " + error);
+    }
+
+    if (std::string move = illegal_move(job->fen, job->moves); !move.empty()) {
+        return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Illegal move: " + move);
+    }
+
+    job->limits.depth = request->depth();
+    job->limits.nodes = request->nodes();
+    job->limits.movetime = request->movetime_ms();
+    job->limits.infinite = !job->limits.depth && !job->limits.nodes && !job->limits.movetime;
+    job->multiPV = std::max(request->multi_pv(), 1);
+    job->queued = now();
+
+    if (!pool.submit(job)) {
+        return grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED, "Analysis queue is full");
+    }
+
+    std::vector<analysis::AnalysisUpdate> updates;
+    while (job->wait(updates, PollMs)) {
+        for (const auto& update : updates) {
+            if (!writer->Write(update)) {
+                pool.cancel(job);
+                return grpc::Status(grpc::StatusCode::CANCELLED, "Client went away");
+            }
+        }
+        updates.clear();
+
+        if (context->IsCancelled()) {
+            pool.cancel(job);
+            return grpc::Status::CANCELLED;
+        }
+    }
+
+    return grpc::Status::OK;
+}
+
+} // namespace Stockfish
@@ -0,0 +1,111 @@
+#ifndef ANALYSIS_SERVICE_H
+#define ANALYSIS_SERVICE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <grpcpp/grpcpp.h>
+#include "analysis.grpc.pb.h"
+#include "engine.h"
+#include "agent_config.h"
+
+namespace Stockfish {
+
+// A queued or running analysis request. The search thread of the engine running
+// it pushes the updates, the RPC handler streams them to the client.
+struct AnalysisJob {
+    // Requests at most this deep, this many nodes or this long are batched
+    static constexpr int      ShortDepth  = 12;
+    static constexpr uint64_t ShortNodes  = 500000;
+    static constexpr int      ShortTimeMs = 250;
+
+    // Updates kept for a slow client, the oldest PV lines are dropped first
+    static constexpr std::size_t MaxPendingUpdates = 256;
+
+    bool is_short() const;
+
+    void push(analysis::AnalysisUpdate&& update);
+    void finish();
+
+    // Waits up to timeoutMs for updates, false once finished and all were taken
+    bool wait(std::vector<analysis::AnalysisUpdate>& out, int timeoutMs);
+
+    std::string              fen;
+    std::vector<std::string> moves;
+    Search::LimitsType       limits;
+    int                      multiPV = 1;
+    TimePoint                queued  = 0;
+
+    std::atomic<bool> cancelled{false};
+    Engine*           engine = nullptr;  // Running on, guarded by the pool mutex
+
+   private:
+    std::mutex                           mutex;
+    std::condition_variable              cv;
+    std::deque<analysis::AnalysisUpdate> updates;
+    bool                                 done = false;
+};
+
+// A fixed set of engines, each with its own threads and hash, serving a bounded
+// queue of jobs. An engine taking a short job also takes its share of the other
+// queued short jobs and runs them back to back, so that bursts of quick requests
+// neither wait behind each other for a wake-up nor leave other engines idle.
+class AnalysisPool {
+public:
+    static constexpr std::size_t BatchSize = 8;
+
+    AnalysisPool(const AgentConfig& config);
+    ~AnalysisPool();
+
+    // False when the queue is full
+    bool submit(std::shared_ptr<AnalysisJob> job);
+    // Stops the job if running, drops it if still queued
+    void cancel(const std::shared_ptr<AnalysisJob>& job);
+
+private:
+    struct Slot {
+        Slot(const std::string& nnueCacheDir) : engine(std::nullopt, nnueCacheDir) {}
+
+        Engine                       engine;
+        std::shared_ptr<AnalysisJob> job;  // Read by the search thread
+        std::thread                  thread;
+    };
+
+    std::vector<std::shared_ptr<AnalysisJob>> take();
+    void run(Slot& slot);
+    void run_job(Slot& slot, const std::shared_ptr<AnalysisJob>& job);
+
+    std::vector<std::unique_ptr<Slot>>       slots;
+    std::deque<std::shared_ptr<AnalysisJob>> queue;
+    std::size_t                              capacity;
+    std::size_t                              idle = 0;
+    std::atomic<bool>                        exit{false};
+    std::mutex                               mutex;
+    std::condition_variable                  cv;
+};
+
+// Local gRPC server of analysis.proto, see there for the API
+class AnalysisService final : public analysis::Analysis::Service {
+public:
+    AnalysisService(const AgentConfig& config);
+    ~AnalysisService();
+
+    grpc::Status Analyse(grpc::ServerContext* context,
+                         const analysis::AnalysisRequest* request,
+                         grpc::ServerWriter<analysis::AnalysisUpdate>* writer) override;
+
+private:
+    AnalysisPool pool;
+    std::unique_ptr<grpc::Server> server;
+};
+
+} // namespace Stockfish
+
+#endif // ANALYSIS_SERVICE_H
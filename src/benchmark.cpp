@@ -0,0 +1,1546 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <iterator>
+#include <memory>
+#include <string_view>
+#include <utility>
+
+#include "engine.h"
+#include "history.h"
+#include "misc.h"
+#include "movegen.h"
+#include "movepick.h"
+#include "nnue/network.h"
+#include "nnue/nnue_accumulator.h"
+#include "perft.h"
+#include "position.h"
+#include "search.h"
+#include "syzygy/tbprobe.h"
+#include "trace.h"
+
+#if defined(__linux__)
+    #include <dirent.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+namespace Stockfish::Benchmark {
+
+const std::vector<std::string> Defaults = {
+  "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+  "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10",
+  "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 11",
+  "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+  "r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b - - 2 15",
+  "r1bbk1nr/pp3p1p/2n5/1N4p1/2Np1B2/8/PPP2PPP/2KR1B1R w kq - 0 13",
+  "r1bq1rk1/ppp1nppp/4n3/3p3Q/3P4/1BP1B3/PP1N2PP/R4RK1 w - - 1 16",
+  "4r1k1/r1q2ppp/ppp2n2/4P3/5Rb1/1N1BQ3/PPP3PP/R5K1 w - - 1 17",
+  "2rqkb1r/ppp2p2/2npb1p1/1N1Nn2p/2P1PP2/8/PP2B1PP/R1BQK2R b KQ - 0 11",
+  "r1bq1r1k/b1p1npp1/p2p3p/1p6/3PP3/1B2NN2/PP3PPP/R2Q1RK1 w - - 1 16",
+  "3r1rk1/p5pp/bpp1pp2/8/q1PP1P2/b3P3/P2NQRPP/1R2B1K1 b - - 6 22",
+  "r1q2rk1/2p1bppp/2Pp4/p6b/Q1PNp3/4B3/PP1R1PPP/2K4R w - - 2 18",
+  "4k2r/1pb2ppp/1p2p3/1R1p4/3P4/2r1PN2/P4PPP/1R4K1 b - - 3 22",
+  "3q2k1/pb3p1p/4pbp1/2r5/PpN2N2/1P2P2P/5PP1/Q2R2K1 b - - 4 26",
+  "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/8 b - - 0 1",
+  "3b4/5kp1/1p1p1p1p/pP1PpP1P/P1P1P3/3KN3/8/8 w - - 0 1",
+  "8/6pk/1p6/8/PP3p1p/5P2/4KP1q/3Q4 w - - 0 1",
+  "7k/3p2pp/4q3/8/4Q3/5Kp1/P6b/8 w - - 0 1",
+  "8/2p5/8/2kPKp1p/2p4P/2P5/3P4/8 w - - 0 1",
+  "8/1p3pp1/7p/5P1P/2k3P1/8/2K2P2/8 w - - 0 1",
+  "8/pp2r1k1/2p1p3/3pP2p/1P1P1P1P/P5KR/8/8 w - - 0 1",
+  "8/3p4/p1bk3p/Pp6/1Kp1PpPp/2P2P1P/2P5/5B2 b - - 0 1",
+  "5k2/7R/4P2p/5K2/p1r2P1p/8/8/8 b - - 0 1",
+  "6k1/6p1/P6p/r1N5/5p2/7P/1b3PP1/4R1K1 w - - 0 1",
+  "1r3k2/4q3/2Pp3b/3Bp3/2Q2p2/1p1P2P1/1P2KP2/3N4 w - - 0 1",
+  "6k1/4pp1p/3p2p1/P1pPb3/R7/1r2P1PP/3B1P2/6K1 w - - 0 1",
+  "8/3p3B/5p2/5P2/p7/PP5b/k7/6K1 w - - 0 1",
+  "5rk1/q6p/2p3bR/1pPp1rP1/1P1Pp3/P3B1Q1/1K3P2/R7 w - - 93 90",
+  "4rrk1/1p1nq3/p7/2p1P1pp/3P2bp/3Q1Bn1/PPPB4/1K2R1NR w - - 40 21",
+  "r3k2r/3nnpbp/q2pp1p1/p7/Pp1PPPP1/4BNN1/1P5P/R2Q1RK1 w kq - 0 16",
+  "3Qb1k1/1r2ppb1/pN1n2q1/Pp1Pp1Pr/4P2p/4BP2/4B1R1/1R5K b - - 11 40",
+  "4k3/3q1r2/1N2r1b1/3ppN2/2nPP3/1B1R2n1/2R1Q3/3K4 w - - 5 1",
+  "8/8/8/8/5kp1/P7/8/1K1N4 w - - 0 1",
+  "8/8/8/5N2/8/p7/8/2NK3k w - - 0 1",
+  "8/3k4/8/8/8/4B3/4KB2/2B5 w - - 0 1",
+  "8/8/1P6/5pr1/8/4R3/7k/2K5 w - - 0 1",
+  "8/2p4P/8/kr6/6R1/8/8/1K6 w - - 0 1",
+  "8/8/3P3k/8/1p6/8/1P6/1K3n2 b - - 0 1",
+  "8/R7/2q5/8/6k1/8/1P5p/K6R w - - 0 124",
+  "6k1/3b3r/1p1p4/p1n2p2/1PPNpP1q/P3Q1p1/1R1RB1P1/5K2 b - - 0 1",
+  "r2r1n2/pp2bk2/2p1p2p/3q4/3PN1QP/2P3R1/P4PP1/5RK1 w - - 0 1",
+};
+
+namespace {
+
+template<typename Network, typename Cache>
+void eval_batch_network(const char*                         name,
+                        const Network&                      network,
+                        const std::vector<const Position*>& positions,
+                        Eval::NNUE::AccumulatorStack&       accumulators,
+                        Cache&                              cache,
+                        std::size_t                         evals,
+                        const std::vector<int>&             batchSizes) {
+
+    using Eval::NNUE::NetworkOutput;
+
+    // Reference results, one position at a time through the regular path
+    std::vector<NetworkOutput> expected(positions.size());
+
+    TimePoint elapsed = now();
+    for (std::size_t done = 0; done < evals; done += positions.size())
+        for (std::size_t i = 0; i < positions.size(); ++i)
+        {
+            accumulators.reset();
+            expected[i] = network.evaluate(*positions[i], accumulators, cache);
+        }
+    elapsed = now() - elapsed + 1;
+
+    std::size_t single = (evals + positions.size() - 1) / positions.size() * positions.size();
+
+    sync_cout << name << " network, " << evals << " evals per batch size\n"
+              << "  single  " << std::setw(12) << 1000 * single / elapsed << " evals/s"
+              << sync_endl;
+
+    for (int batchSize : batchSizes)
+    {
+        std::vector<const Position*> batch(batchSize);
+        std::vector<NetworkOutput>   outputs(batchSize);
+        bool                         mismatch = false;
+
+        for (int i = 0; i < batchSize; ++i)
+            batch[i] = positions[i % positions.size()];
+
+        std::size_t done = 0;
+        elapsed          = now();
+        for (; done < evals; done += batchSize)
+            network.evaluate_batch(batch.data(), batch.size(), accumulators, cache,
+                                   outputs.data());
+        elapsed = now() - elapsed + 1;
+
+        for (int i = 0; i < batchSize; ++i)
+            mismatch |= outputs[i] != expected[i % positions.size()];
+
+        sync_cout << "  batch " << std::setw(3) << batchSize << std::setw(12)
+                  << 1000 * done / elapsed << " evals/s"
+                  << (mismatch ? "  MISMATCH with single evaluation" : "") << sync_endl;
+    }
+}
+
+// Starting positions of the move generator checks, with castling in standard and
+// Chess960 positions, en passant captures next to pins, checks and promotions.
+const std::pair<const char*, bool> MovegenPositions[] = {
+  {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", false},
+  {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", false},
+  {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", false},
+  {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", false},
+  {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", false},
+  {"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", false},
+  {"8/8/8/2k5/2pP4/8/B7/4K3 b - d3 0 1", false},
+  {"8/8/8/8/k2Pp2Q/8/8/3K4 b - d3 0 1", false},
+  {"bqnb1rkr/pp3ppp/3ppn2/2p5/5P2/P2P4/NPP1P1PP/BQ1BNRKR w HFhf - 2 9", true},
+  {"2nnrbkr/p1qppppp/8/1ppb4/6PP/3PP3/PPP2P2/BQNNRBKR w HEhe - 1 9", true},
+};
+
+// Counts the leaf nodes at the given depth with the moves of the given generator
+template<GenType Type>
+std::uint64_t perft_count(Position& pos, int depth) {
+
+    if (depth <= 1)
+        return MoveList<Type>(pos).size();
+
+    StateInfo     st;
+    std::uint64_t nodes = 0;
+
+    for (const auto& m : MoveList<Type>(pos))
+    {
+        pos.do_move(m, st);
+        nodes += perft_count<Type>(pos, depth - 1);
+        pos.undo_move(m);
+    }
+    return nodes;
+}
+
+// Compares the moves of both generators at every node of the move tree, and
+// returns the number of nodes where they differ.
+std::uint64_t movegen_check(Position& pos, int depth, std::uint64_t& nodes) {
+
+    auto sorted = [](const auto& list) {
+        std::vector<Move> moves(list.begin(), list.end());
+        std::sort(moves.begin(), moves.end(),
+                  [](const Move& a, const Move& b) { return a.raw() < b.raw(); });
+        return moves;
+    };
+
+    std::vector<Move> moves = sorted(MoveList<LEGAL>(pos));
+    std::uint64_t     mismatches = 0;
+
+    ++nodes;
+    if (moves != sorted(MoveList<LEGAL_FILTERED>(pos)))
+    {
+        sync_cout << "Mismatch: " << pos.fen() << sync_endl;
+        ++mismatches;
+    }
+
+    if (depth <= 0)
+        return mismatches;
+
+    StateInfo st;
+    for (const auto& m : moves)
+    {
+        pos.do_move(m, st);
+        mismatches += movegen_check(pos, depth - 1, nodes);
+        pos.undo_move(m);
+    }
+    return mismatches;
+}
+
+// History tables of the move picker benchmark
+struct PickerHistories {
+    ButterflyHistory      mainHistory;
+    LowPlyHistory         lowPlyHistory;
+    CapturePieceToHistory captureHistory;
+    ContinuationHistory   continuationHistory;
+    PawnHistory           pawnHistory{PAWN_HISTORY_SIZE};
+};
+
+// Fills a history table with random values in half of its range
+template<typename T, int D>
+void randomize(StatsEntry<T, D>& entry, PRNG& rng) {
+    entry = T(int(rng.rand<std::uint64_t>() % (D + 1)) - D / 2);
+}
+
+template<typename Table>
+void randomize(Table& table, PRNG& rng) {
+    for (auto& entry : table)
+        randomize(entry, rng);
+}
+
+// Probe latencies in nanoseconds of one kind of probe
+struct ProbeLatencies {
+    const char*                name;
+    std::vector<std::uint64_t> ns;
+
+    void report() {
+        if (ns.empty())
+            return;
+
+        std::sort(ns.begin(), ns.end());
+        auto pct = [&](double p) { return double(ns[std::size_t(p * (ns.size() - 1))]) / 1000; };
+
+        sync_cout << std::fixed << std::setprecision(1) << name << " probes: " << ns.size()
+                  << ", p50 " << pct(0.5) << " us, p90 " << pct(0.9) << " us, p99 " << pct(0.99)
+                  << " us, max " << pct(1.0) << " us" << sync_endl;
+    }
+};
+
+// Probe every position of the move tree within the tablebase piece count, the
+// way the search probes the positions it reaches.
+void tb_probe_tree(
+  Position& pos, int depth, bool useCache, ProbeLatencies& wdl, ProbeLatencies& dtz) {
+
+    if (pos.count<ALL_PIECES>() <= Tablebases::MaxCardinality && !pos.can_castle(ANY_CASTLING))
+    {
+        Tablebases::ProbeState result;
+
+        auto start = std::chrono::steady_clock::now();
+        Tablebases::probe_wdl(pos, &result, useCache);
+        auto mid = std::chrono::steady_clock::now();
+        Tablebases::probe_dtz(pos, &result, useCache);
+        auto end = std::chrono::steady_clock::now();
+
+        wdl.ns.push_back(std::chrono::nanoseconds(mid - start).count());
+        dtz.ns.push_back(std::chrono::nanoseconds(end - mid).count());
+    }
+
+    if (depth <= 0)
+        return;
+
+    StateInfo st;
+    for (const auto& m : MoveList<LEGAL>(pos))
+    {
+        pos.do_move(m, st);
+        tb_probe_tree(pos, depth - 1, useCache, wdl, dtz);
+        pos.undo_move(m);
+    }
+}
+
+// Drop the pages of the tablebase files from the page cache, so that the next
+// process starts cold. Only effective for files that no process has mapped.
+void evict_tb_files(const std::string& paths) {
+#if defined(__linux__)
+    std::stringstream ss(paths);
+    std::string       dir;
+
+    while (std::getline(ss, dir, ':'))
+    {
+        DIR* d = opendir(dir.c_str());
+        if (!d)
+            continue;
+
+        while (const dirent* entry = readdir(d))
+        {
+            std::string_view name(entry->d_name);
+            std::string_view ext = name.substr(std::max<std::size_t>(name.size(), 5) - 5);
+            if (ext != ".rtbw" && ext != ".rtbz")
+                continue;
+
+            int fd = open((dir + "/" + entry->d_name).c_str(), O_RDONLY);
+            if (fd == -1)
+                continue;
+
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            close(fd);
+        }
+        closedir(d);
+    }
+#else
+    (void) paths;
+#endif
+}
+
+}  // namespace
+
+void eval_batch(const Eval::NNUE::Networks& networks,
+                std::size_t                 evals,
+                const std::vector<int>&     batchSizes) {
+
+    std::vector<StateInfo>       states(Defaults.size());
+    std::vector<Position>        positions(Defaults.size());
+    std::vector<const Position*> ptrs;
+
+    for (std::size_t i = 0; i < Defaults.size(); ++i)
+    {
+        positions[i].set(Defaults[i], false, &states[i]);
+        ptrs.push_back(&positions[i]);
+    }
+
+    auto accumulators = std::make_unique<Eval::NNUE::AccumulatorStack>();
+    auto caches       = std::make_unique<Eval::NNUE::AccumulatorCaches>(networks);
+
+    eval_batch_network("Big", networks.big, ptrs, *accumulators, caches->big, evals, batchSizes);
+    eval_batch_network("Small", networks.small, ptrs, *accumulators, caches->small, evals,
+                       batchSizes);
+}
+
+void net_load(const std::string& binaryPath, const std::string& cacheDirectory) {
+
+    // The first run with a cache directory writes the images if they are not
+    // there yet, the second one is the startup time of a later process.
+    const std::pair<const char*, std::string> runs[] = {
+      {"no cache", ""}, {"cache, first", cacheDirectory}, {"cache, second", cacheDirectory}};
+
+    for (const auto& [name, dir] : runs)
+    {
+        TimePoint elapsed = now();
+        Engine    engine(binaryPath, dir);
+        elapsed = now() - elapsed;
+
+        sync_cout << "Engine startup (" << name << "): " << elapsed << " ms" << sync_endl;
+    }
+}
+
+std::uint64_t search(Engine& engine, int depth) {
+
+    std::uint64_t nodes = 0, lastNodes = 0;
+    engine.set_on_update_no_moves([](const Engine::InfoShort&) {});
+    engine.set_on_update_full([&](const Engine::InfoFull& info) { lastNodes = info.nodes; });
+    engine.set_on_iter([](const Engine::InfoIter&) {});
+    engine.set_on_bestmove([](std::string_view, std::string_view) {});
+    engine.search_clear();
+
+    TimePoint elapsed = now();
+
+    for (std::size_t i = 0; i < Defaults.size(); ++i)
+    {
+        std::cerr << "\nPosition: " << i + 1 << '/' << Defaults.size() << " (" << Defaults[i]
+                  << ")" << std::endl;
+
+        Search::LimitsType limits;
+        limits.depth     = depth;
+        limits.startTime = now();
+
+        engine.set_position(Defaults[i], {});
+        engine.go(limits);
+        engine.wait_for_search_finished();
+        nodes += lastNodes;
+    }
+
+    elapsed = now() - elapsed + 1;  // Ensure positivity to avoid a 'divide by zero'
+
+    std::cerr << "\n==========================="
+              << "\nTotal time (ms) : " << elapsed << "\nNodes searched  : " << nodes
+              << "\nNodes/second    : " << 1000 * nodes / elapsed << std::endl;
+
+    auto threats = engine.get_threat_stats();
+    if (threats.updates || threats.refreshes)
+        std::cerr << std::fixed << std::setprecision(2)
+                  << "Threat updates  : " << double(threats.updates) / nodes << " per node, "
+                  << double(threats.updateFeatures) / std::max<std::uint64_t>(threats.updates, 1)
+                  << " features each"
+                  << "\nThreat refreshes: " << double(threats.refreshes) / nodes << " per node, "
+                  << double(threats.refreshFeatures) / std::max<std::uint64_t>(threats.refreshes, 1)
+                  << " features each ("
+                  << double(threats.activeFeatures) / std::max<std::uint64_t>(threats.refreshes, 1)
+                  << " without the refresh cache)" << std::endl;
+
+    auto stats = engine.get_eval_cache_stats();
+    if (stats.probes)
+        std::cerr << "Eval cache hits : " << std::fixed << std::setprecision(1)
+                  << 100.0 * stats.hits / stats.probes << "% of " << stats.probes << " probes"
+                  << std::endl;
+
+    return nodes;
+}
+
+void eval_cache(Engine& engine, int depth) {
+
+    engine.get_options()["EvalCache"] = std::string("false");
+    std::uint64_t nodes = search(engine, depth);
+
+    engine.get_options()["EvalCache"] = std::string("true");
+    if (search(engine, depth) != nodes)
+        std::cerr << "\nMISMATCH: the eval cache changed the search" << std::endl;
+}
+
+void compact_history(Engine& engine, int depth) {
+
+    for (const char* compact : {"false", "true"})
+    {
+        engine.get_options()["CompactHistory"] = std::string(compact);
+        std::cerr << "\nCompactHistory " << compact << "\n"
+                  << engine.memory_footprint_as_string() << std::endl;
+        search(engine, depth);
+    }
+}
+
+void prefetch_ahead(Engine& engine, int depth) {
+
+    std::uint64_t nodes = 0;
+
+    for (const char* ahead : {"0", "1", "2"})
+    {
+        engine.get_options()["TTPrefetchAhead"] = std::string(ahead);
+        std::cerr << "\nTTPrefetchAhead " << ahead << std::endl;
+
+        std::uint64_t n = search(engine, depth);
+        if (nodes && n != nodes)
+            std::cerr << "\nMISMATCH: the prefetches changed the search" << std::endl;
+        nodes = n;
+    }
+
+    engine.get_options()["TTPrefetchAhead"] = std::string("0");
+}
+
+void tt_stats(Engine& engine, int depth) {
+
+    engine.set_on_update_no_moves([](const Engine::InfoShort&) {});
+    engine.set_on_update_full([](const Engine::InfoFull&) {});
+    engine.set_on_iter([](const Engine::InfoIter&) {});
+    engine.set_on_bestmove([](std::string_view, std::string_view) {});
+    engine.search_clear();
+
+    // The positions in a row without clearing the table, as the moves of a game
+    for (std::size_t i = 0; i < Defaults.size(); ++i)
+    {
+        Search::LimitsType limits;
+        limits.depth     = depth;
+        limits.startTime = now();
+
+        engine.set_position(Defaults[i], {});
+        engine.go(limits);
+        engine.wait_for_search_finished();
+
+        sync_cout << "Position " << i + 1 << ": " << engine.tt_stats_as_string() << sync_endl;
+    }
+
+    const TTOccupancy o = engine.get_tt_occupancy();
+
+    auto percent = [&](std::uint64_t n) {
+        return o.occupied ? 100.0 * double(n) / double(o.occupied) : 0.0;
+    };
+
+    sync_cout << std::fixed << std::setprecision(2) << "\n"
+              << o.occupied << " of " << o.entries << " entries occupied, " << percent(o.pv)
+              << "% pv, bounds none " << percent(o.bound[BOUND_NONE]) << "% upper "
+              << percent(o.bound[BOUND_UPPER]) << "% lower "
+              << percent(o.bound[BOUND_LOWER]) << "% exact " << percent(o.bound[BOUND_EXACT])
+              << "%\n\nAge       entries        %" << sync_endl;
+
+    for (std::size_t i = 0; i < o.age.size(); ++i)
+        if (o.age[i])
+            sync_cout << std::setw(3) << i << std::setw(14) << o.age[i] << std::setw(9)
+                      << percent(o.age[i]) << sync_endl;
+
+    sync_cout << "\nDepth     entries        %" << sync_endl;
+
+    for (std::size_t i = 0; i < o.depth.size(); ++i)
+        if (o.depth[i])
+        {
+            int d = int(i) + DEPTH_ENTRY_OFFSET;
+            sync_cout << std::setw(5)
+                      << (d == DEPTH_UNSEARCHED ? std::string("none") : std::to_string(d))
+                      << std::setw(12) << o.depth[i] << std::setw(9) << percent(o.depth[i])
+                      << sync_endl;
+        }
+}
+
+void tt_front(Engine& engine, int depth, const std::vector<std::string>& hashSizes) {
+
+    std::uint64_t lastNodes = 0;
+    engine.set_on_update_no_moves([](const Engine::InfoShort&) {});
+    engine.set_on_update_full([&](const Engine::InfoFull& info) { lastNodes = info.nodes; });
+    engine.set_on_iter([](const Engine::InfoIter&) {});
+    engine.set_on_bestmove([](std::string_view, std::string_view) {});
+
+    sync_cout << "Hash MB  front        nodes  nodes/s   gain %   hits %  front hits %"
+              << sync_endl;
+
+    for (const auto& hash : hashSizes)
+    {
+        engine.get_options()["Hash"] = hash;
+        double nps[2]{};
+
+        for (int front : {0, 1})
+        {
+            engine.get_options()["TTFront"] = std::string(front ? "true" : "false");
+            engine.search_clear();
+
+            std::uint64_t nodes = 0, probes = 0, hits = 0, frontHits = 0;
+            TimePoint     elapsed = now();
+
+            for (const auto& fen : Defaults)
+            {
+                Search::LimitsType limits;
+                limits.depth     = depth;
+                limits.startTime = now();
+
+                engine.set_position(fen, {});
+                engine.go(limits);
+                engine.wait_for_search_finished();
+
+                const TTCounters c = engine.get_tt_counters();
+                nodes += lastNodes;
+                probes += c.probes;
+                hits += c.hits;
+                frontHits += c.frontHits;
+            }
+
+            elapsed     = now() - elapsed + 1;
+            nps[front]  = 1000.0 * double(nodes) / double(elapsed);
+            auto rate   = [&](std::uint64_t n) { return probes ? 100.0 * n / probes : 0.0; };
+
+            sync_cout << std::fixed << std::setprecision(2) << std::setw(7) << hash
+                      << std::setw(7) << (front ? "on" : "off") << std::setw(13) << nodes
+                      << std::setw(9) << std::uint64_t(nps[front]) << std::setw(9)
+                      << (front ? 100 * (nps[1] / nps[0] - 1) : 0.0) << std::setw(9)
+                      << rate(hits) << std::setw(14) << rate(frontHits) << sync_endl;
+        }
+    }
+
+    engine.get_options()["TTFront"] = std::string("false");
+}
+
+void shared_history(Engine& engine, int depth, std::size_t maxThreads) {
+
+    struct Row {
+        std::size_t   threads;
+        TimePoint     own, shared;
+        std::uint64_t ownNodes, sharedNodes;
+    };
+    std::vector<Row> rows;
+
+    for (std::size_t n = 1;; n = std::min(n * 2, maxThreads))
+    {
+        Row row{n, 0, 0, 0, 0};
+        engine.get_options()["Threads"] = std::to_string(n);
+
+        for (bool shared : {false, true})
+        {
+            engine.get_options()["SharedHistory"] = std::string(shared ? "true" : "false");
+            std::cerr << "\nThreads " << n << ", SharedHistory " << shared << std::endl;
+
+            TimePoint     start = now();
+            std::uint64_t nodes = search(engine, depth);
+            TimePoint     time  = now() - start + 1;
+
+            (shared ? row.shared : row.own)           = time;
+            (shared ? row.sharedNodes : row.ownNodes) = nodes;
+        }
+        rows.push_back(row);
+
+        if (n == maxThreads)
+            break;
+    }
+
+    sync_cout << "\nTime to depth " << depth << " (ms) and nodes/second, own and shared histories"
+              << sync_endl;
+    for (const auto& r : rows)
+        sync_cout << "Threads " << std::setw(3) << r.threads << ": " << std::setw(8) << r.own
+                  << std::setw(8) << r.shared << std::setw(12) << 1000 * r.ownNodes / r.own
+                  << std::setw(12) << 1000 * r.sharedNodes / r.shared << "  speedup "
+                  << std::fixed << std::setprecision(2) << double(r.own) / r.shared << sync_endl;
+}
+
+void thread_placement(Engine& engine, int depth) {
+
+    std::vector<std::pair<std::string, std::uint64_t>> rows;
+
+    for (const char* placement : {"numa", "cores", "siblings"})
+    {
+        engine.get_options()["ThreadPlacement"] = std::string(placement);
+        std::cerr << "\nThreadPlacement " << placement << "\n"
+                  << engine.thread_allocation_information_as_string() << std::endl;
+
+        TimePoint     start = now();
+        std::uint64_t nodes = search(engine, depth);
+        rows.emplace_back(placement, 1000 * nodes / (now() - start + 1));
+    }
+
+    sync_cout << "\nNodes/second with " << int(engine.get_options()["Threads"]) << " threads"
+              << sync_endl;
+    for (const auto& [placement, nps] : rows)
+        sync_cout << std::left << std::setw(10) << placement << std::right << std::setw(12) << nps
+                  << sync_endl;
+}
+
+void deterministic(Engine& engine, int depth, int quantum) {
+
+    std::uint64_t lastNodes = 0;
+    std::string   lastMove;
+    engine.set_on_update_no_moves([](const Engine::InfoShort&) {});
+    engine.set_on_update_full([&](const Engine::InfoFull& info) { lastNodes = info.nodes; });
+    engine.set_on_iter([](const Engine::InfoIter&) {});
+    engine.set_on_bestmove(
+      [&](std::string_view bestmove, std::string_view) { lastMove = std::string(bestmove); });
+
+    for (int q : {0, quantum})
+    {
+        engine.get_options()["DeterministicQuantum"] = std::to_string(q);
+
+        std::vector<std::vector<std::pair<std::string, std::uint64_t>>> runs(2);
+        std::uint64_t                                                   nodes = 0;
+        TimePoint                                                       time  = 0;
+
+        for (auto& results : runs)
+        {
+            engine.search_clear();
+            TimePoint start = now();
+
+            for (const auto& fen : Defaults)
+            {
+                Search::LimitsType limits;
+                limits.depth     = depth;
+                limits.startTime = now();
+
+                engine.set_position(fen, {});
+                engine.go(limits);
+                engine.wait_for_search_finished();
+                results.emplace_back(lastMove, lastNodes);
+                nodes += lastNodes;
+            }
+            time += now() - start;
+        }
+
+        std::size_t differ = 0;
+        for (std::size_t i = 0; i < Defaults.size(); ++i)
+            differ += runs[0][i] != runs[1][i];
+
+        sync_cout << "DeterministicQuantum " << std::setw(7) << q << ": " << std::setw(10)
+                  << 1000 * nodes / (time + 1) << " nodes/second, " << differ << " of "
+                  << Defaults.size() << " positions differ between two runs" << sync_endl;
+    }
+}
+
+void tb_probe(const std::string& paths, int depth, const std::string& mode) {
+
+    Tablebases::init(paths);
+
+    if (!Tablebases::MaxCardinality)
+    {
+        sync_cout << "No tablebases found in " << paths << sync_endl;
+        return;
+    }
+
+    std::vector<std::string> fens;
+    for (const auto& fen : Defaults)
+    {
+        StateInfo st;
+        Position  pos;
+        if (pos.set(fen, false, &st).count<ALL_PIECES>() <= Tablebases::MaxCardinality + 2)
+            fens.push_back(fen);
+    }
+
+    bool useCache = mode == "cache" || mode == "both";
+
+    if (mode == "warmup" || mode == "both")
+    {
+        TimePoint elapsed = now();
+        for (const auto& fen : fens)
+        {
+            StateInfo st;
+            Position  pos;
+            Tablebases::warm_up(pos.set(fen, false, &st), false, true);
+        }
+        sync_cout << "Warm-up: " << now() - elapsed << " ms" << sync_endl;
+    }
+
+    ProbeLatencies wdl{"WDL", {}}, dtz{"DTZ", {}};
+
+    for (const auto& fen : fens)
+    {
+        StateInfo st;
+        Position  pos;
+        pos.set(fen, false, &st);
+        tb_probe_tree(pos, depth, useCache, wdl, dtz);
+    }
+
+    sync_cout << "Mode " << mode << ", " << fens.size() << " positions, depth " << depth
+              << sync_endl;
+    wdl.report();
+    dtz.report();
+}
+
+std::uint64_t movegen(int games, int depth, std::uint64_t seed) {
+
+    PRNG          rng(seed);
+    std::uint64_t nodes = 0, mismatches = 0;
+
+    for (int g = 0; g < games; ++g)
+    {
+        const auto& [fen, isChess960] = MovegenPositions[g % std::size(MovegenPositions)];
+
+        StateListPtr states = make_state_list();
+        Position     pos;
+        pos.set(fen, isChess960, &states->back());
+
+        // Play a random game, checking the move tree of every position on the way
+        for (int ply = 0; ply < 200; ++ply)
+        {
+            mismatches += movegen_check(pos, depth, nodes);
+
+            MoveList<LEGAL> moves(pos);
+            if (!moves.size() || pos.is_draw(ply))
+                break;
+
+            states->emplace_back();
+            pos.do_move(moves.begin()[rng.rand<std::uint64_t>() % moves.size()], states->back());
+        }
+    }
+
+    sync_cout << "Checked " << nodes << " positions of " << games << " random games, "
+              << mismatches << " mismatches" << sync_endl;
+
+    std::uint64_t counts[2] = {};
+    const char*   names[]   = {"legal", "filtered"};
+
+    for (int i = 0; i < 2; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        for (const auto& [fen, isChess960] : MovegenPositions)
+        {
+            StateInfo st;
+            Position  pos;
+            pos.set(fen, isChess960, &st);
+            counts[i] += i == 0 ? perft_count<LEGAL>(pos, 5) : perft_count<LEGAL_FILTERED>(pos, 5);
+        }
+
+        std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+
+        sync_cout << "Perft 5 (" << names[i] << "): " << counts[i] << " nodes, " << std::fixed
+                  << std::setprecision(1) << counts[i] / seconds.count() / 1e6 << " Mnps"
+                  << sync_endl;
+    }
+
+    return mismatches + (counts[0] != counts[1]);
+}
+
+std::uint64_t move_pick(int iterations) {
+
+    PRNG rng(1070372);
+    auto histories = std::make_unique<PickerHistories>();
+
+    randomize(histories->mainHistory, rng);
+    randomize(histories->lowPlyHistory, rng);
+    randomize(histories->captureHistory, rng);
+    randomize(histories->continuationHistory, rng);
+    randomize(histories->pawnHistory, rng);
+
+    // The positions of short random games from the default positions
+    std::vector<std::string> fens;
+    for (const auto& fen : Defaults)
+    {
+        StateListPtr states = make_state_list();
+        Position     pos;
+        pos.set(fen, false, &states->back());
+
+        for (int ply = 0; ply < 16; ++ply)
+        {
+            fens.push_back(pos.fen());
+
+            MoveList<LEGAL> moves(pos);
+            if (!moves.size() || pos.is_draw(ply))
+                break;
+
+            states->emplace_back();
+            pos.do_move(moves.begin()[rng.rand<std::uint64_t>() % moves.size()], states->back());
+        }
+    }
+
+    auto positions = std::make_unique<Position[]>(fens.size());
+    auto states    = std::make_unique<StateInfo[]>(fens.size());
+
+    // Every position at qsearch and main search depths, with a TT move half of the
+    // time and the continuation histories of random previous moves.
+    struct Case {
+        const Position*       pos;
+        Move                  ttMove;
+        Depth                 depth;
+        int                   ply;
+        const PieceToHistory* continuationHistory[6];
+    };
+
+    std::vector<Case> cases;
+    for (std::size_t i = 0; i < fens.size(); ++i)
+    {
+        positions[i].set(fens[i], false, &states[i]);
+        MoveList<LEGAL> moves(positions[i]);
+
+        for (Depth depth : {0, 1, 4, 8, 12})
+        {
+            Case c{&positions[i], Move::none(), depth, int(rng.rand<std::uint64_t>() % 8), {}};
+
+            if (moves.size() && rng.rand<std::uint64_t>() % 2)
+                c.ttMove = moves.begin()[rng.rand<std::uint64_t>() % moves.size()];
+
+            for (auto& ch : c.continuationHistory)
+                ch = &histories->continuationHistory[rng.rand<std::uint64_t>() % PIECE_NB]
+                                                    [rng.rand<std::uint64_t>() % SQUARE_NB];
+            cases.push_back(c);
+        }
+    }
+
+    // Emits up to the given number of moves of every case, as after a cutoff, and
+    // returns the number of calls to next_move()
+    auto pick = [&](bool vectorized, int maxMoves, std::vector<Move>* emitted) {
+        std::uint64_t calls = 0;
+
+        for (auto& c : cases)
+        {
+            MovePicker mp(*c.pos, c.ttMove, c.depth, &histories->mainHistory,
+                          &histories->lowPlyHistory, &histories->captureHistory,
+                          c.continuationHistory, &histories->pawnHistory, c.ply, vectorized);
+            Move m;
+            int  moves = 0;
+
+            do
+            {
+                m = mp.next_move();
+                ++calls;
+                if (emitted)
+                    emitted->push_back(m);
+            } while (m && ++moves < maxMoves);
+        }
+        return calls;
+    };
+
+    std::vector<Move> emitted[2];
+    const char*       names[] = {"scalar", "vectorized"};
+
+    for (int i = 0; i < 2; ++i)
+        pick(i, MAX_MOVES, &emitted[i]);
+
+    std::uint64_t mismatches = 0;
+    for (std::size_t i = 0; i < emitted[0].size() && i < emitted[1].size(); ++i)
+        mismatches += emitted[0][i] != emitted[1][i];
+    mismatches += emitted[0].size() != emitted[1].size();
+
+    sync_cout << "Move picker: " << cases.size() << " pickers of " << fens.size()
+              << " positions, random histories, " << mismatches << " mismatches" << sync_endl;
+
+    // Best of several rounds, alternating both paths, as the timings are noisy
+    for (int maxMoves : {MAX_MOVES, 3})
+    {
+        double best[2] = {1e9, 1e9};
+
+        for (int round = 0; round < 10; ++round)
+            for (int i = 0; i < 2; ++i)
+            {
+                std::uint64_t calls = 0;
+                auto          start = std::chrono::steady_clock::now();
+
+                for (int n = 0; n < std::max(iterations / 10, 1); ++n)
+                    calls += pick(i, maxMoves, nullptr);
+
+                std::chrono::duration<double, std::nano> ns =
+                  std::chrono::steady_clock::now() - start;
+                best[i] = std::min(best[i], ns.count() / calls);
+            }
+
+        for (int i = 0; i < 2; ++i)
+            sync_cout << (maxMoves == MAX_MOVES ? "All moves  " : "First 3    ") << std::setw(11)
+                      << names[i] << ": " << std::fixed << std::setprecision(1) << best[i]
+                      << " ns per next_move" << sync_endl;
+    }
+
+    return mismatches;
+}
+
+void perft_threads(ThreadPool& threads, int depth, std::size_t hashMB) {
+
+    std::unique_ptr<PerftTable> table = hashMB ? std::make_unique<PerftTable>(hashMB) : nullptr;
+    std::uint64_t               nodes = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (const auto& [fen, isChess960] : MovegenPositions)
+        nodes += perft(threads, fen, depth, isChess960, table.get(), false);
+
+    std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+    double                        mnps    = nodes / seconds.count() / 1e6;
+
+    sync_cout << "Threads " << std::setw(3) << threads.num_threads() << ": " << nodes
+              << " nodes, " << std::fixed << std::setprecision(1) << mnps << " Mnps, "
+              << mnps / threads.num_threads() << " Mnps per thread" << sync_endl;
+}
+
+void setup(Engine& engine, int plies) {
+
+#ifndef USE_ALLOC_COUNT
+    sync_cout << "Allocations are only counted in builds with allocs=yes" << sync_endl;
+    return;
+#endif
+
+    // Moves of a random game from the start position, and the move lists the agent
+    // sends at each ply
+    std::vector<std::vector<std::string>> games(1);
+    {
+        StateListPtr states = make_state_list();
+        Position     pos;
+        PRNG         rng(1070372);
+        pos.set(Defaults[0], false, &states->back());
+
+        for (int ply = 0; ply < plies; ++ply)
+        {
+            MoveList<LEGAL> moves(pos);
+            if (!moves.size() || pos.is_draw(ply))
+                break;
+
+            Move m = moves.begin()[rng.rand<std::uint64_t>() % moves.size()];
+            games.push_back(games.back());
+            games.back().push_back(move_to_string(m, false));
+            states->emplace_back();
+            pos.do_move(m, states->back());
+        }
+    }
+
+    engine.set_on_update_no_moves([](const Engine::InfoShort&) {});
+    engine.set_on_update_full([](const Engine::InfoFull&) {});
+    engine.set_on_iter([](const Engine::InfoIter&) {});
+    engine.set_on_bestmove([](std::string_view, std::string_view) {});
+
+    // Silence the output of the searches
+    std::streambuf* out = std::cout.rdbuf(nullptr);
+
+    auto allocations = [&](bool search) {
+        dbg_count_allocations(true);
+
+        for (const auto& moves : games)
+        {
+            engine.set_position(Defaults[0], moves);
+
+            if (search)
+            {
+                Search::LimitsType limits;
+                limits.depth     = 1;
+                limits.startTime = now();
+                engine.go(limits);
+                engine.wait_for_search_finished();
+            }
+        }
+
+        dbg_count_allocations(false);
+        return double(dbg_allocations()) / games.size();
+    };
+
+    // The first round grows the state lists to the length of the game
+    double first = allocations(true), steady = allocations(false),
+           steadySearch = allocations(true);
+
+    std::cout.clear();
+    std::cout.rdbuf(out);
+
+    sync_cout << std::fixed << std::setprecision(1) << games.size()
+              << " plies, allocations per move"
+              << "\nFirst round, setup and depth 1 search: " << first
+              << "\nSteady state, setup only            : " << steady
+              << "\nSteady state, setup and search      : " << steadySearch << sync_endl;
+}
+
+void skill_match(
+  const std::string& binaryPath, int games, int movetime, int level, int rescoreLevel) {
+
+    constexpr int MaxPlies = 400;
+
+    // Player 0 rescores the candidates, player 1 runs the MultiPV search
+    std::unique_ptr<Engine> engines[2];
+    std::string             bestmove;
+    int                     depth      = 0;
+    std::uint64_t           depths[2]  = {}, moves[2] = {};
+    int                     results[3] = {};  // Losses, draws and wins of player 0
+
+    for (int i = 0; i < 2; ++i)
+    {
+        engines[i]     = std::make_unique<Engine>(binaryPath);
+        Engine& engine = *engines[i];
+
+        engine.get_options()["Skill Level"]  = std::to_string(i == 0 ? rescoreLevel : level);
+        engine.get_options()["SkillRescore"] = std::string(i == 0 ? "true" : "false");
+        engine.set_on_verify_networks([](std::string_view) {});
+        engine.set_on_update_no_moves([](const Engine::InfoShort&) {});
+        engine.set_on_update_full([&](const Engine::InfoFull& info) { depth = info.depth; });
+        engine.set_on_iter([](const Engine::InfoIter&) {});
+        engine.set_on_bestmove([&](std::string_view m, std::string_view) { bestmove = m; });
+    }
+
+    for (int g = 0; g < games; ++g)
+    {
+        // Each opening is played twice, with colors swapped
+        const std::string&       fen   = Defaults[(g / 2) % Defaults.size()];
+        Color                    color = g % 2 ? BLACK : WHITE;  // Of player 0
+        StateListPtr             states = make_state_list();
+        Position                 pos;
+        std::vector<std::string> played;
+        int                      result = 1;
+
+        pos.set(fen, false, &states->back());
+        engines[0]->search_clear();
+        engines[1]->search_clear();
+
+        for (int ply = 0; ply < MaxPlies && !pos.is_draw(ply); ++ply)
+        {
+            if (!MoveList<LEGAL>(pos).size())
+            {
+                if (pos.checkers())
+                    result = pos.side_to_move() == color ? 0 : 2;
+                break;
+            }
+
+            int player = pos.side_to_move() == color ? 0 : 1;
+
+            Search::LimitsType limits;
+            limits.movetime  = movetime;
+            limits.startTime = now();
+
+            engines[player]->set_position(fen, played);
+            engines[player]->go(limits);
+            engines[player]->wait_for_search_finished();
+
+            depths[player] += depth;
+            ++moves[player];
+
+            states->emplace_back();
+            pos.do_move(to_move(pos, bestmove), states->back());
+            played.push_back(bestmove);
+        }
+
+        ++results[result];
+        std::cerr << "Game " << g + 1 << '/' << games << ": "
+                  << (result == 2 ? "rescore wins" : result ? "draw" : "multipv wins") << " in "
+                  << played.size() << " plies" << std::endl;
+    }
+
+    double score = (results[2] + 0.5 * results[1]) / std::max(games, 1);
+    double elo   = -400 * std::log10(1 / std::clamp(score, 0.001, 0.999) - 1);
+
+    sync_cout << "\nSkill Level " << rescoreLevel << " rescore vs " << level << " multipv, "
+              << movetime << " ms per move"
+              << "\nRescore vs MultiPV: +" << results[2] << " =" << results[1] << " -" << results[0]
+              << std::fixed << std::setprecision(1) << ", " << elo << " Elo"
+              << "\nAverage depth     : " << double(depths[0]) / std::max<std::uint64_t>(moves[0], 1)
+              << " rescore, " << double(depths[1]) / std::max<std::uint64_t>(moves[1], 1)
+              << " multipv" << sync_endl;
+}
+
+void time_play(const std::string& binaryPath,
+               int                games,
+               int                base,
+               int                inc,
+               double             noise,
+               const std::string& logFile,
+               const std::string& table) {
+
+    constexpr int MaxPlies = 400;
+
+    std::unique_ptr<Engine> engines[2];
+    std::string             bestmove;
+    TimeModel               model;
+    PRNG                    rng(now() | 1);
+    std::ofstream           log(logFile, std::ios::app);
+    TimePoint               used = 0, moves = 0;
+
+    if (!table.empty() && !model.load(table))
+    {
+        sync_cout << "Failed to load the time model " << table << sync_endl;
+        return;
+    }
+
+    for (auto& engine : engines)
+    {
+        engine = std::make_unique<Engine>(binaryPath);
+        engine->set_on_verify_networks([](std::string_view) {});
+        engine->set_on_update_no_moves([](const Engine::InfoShort&) {});
+        engine->set_on_update_full([](const Engine::InfoFull&) {});
+        engine->set_on_iter([](const Engine::InfoIter&) {});
+        engine->set_on_bestmove([&](std::string_view m, std::string_view) { bestmove = m; });
+    }
+
+    // A random offset of the log of all the scales, in [-noise, noise]
+    auto offset = [&]() { return noise * (2 * double(rng.rand<std::uint64_t>() >> 11) / 0x1p53 - 1); };
+
+    // Game ids are unique across runs appending to the same log
+    const auto runId = std::chrono::duration_cast<std::chrono::milliseconds>(
+                         std::chrono::system_clock::now().time_since_epoch())
+                         .count();
+
+    for (int g = 0; g < games; ++g)
+    {
+        const std::string&       fen    = Defaults[(g / 2) % Defaults.size()];
+        StateListPtr             states = make_state_list();
+        Position                 pos;
+        std::vector<std::string> played;
+        TimePoint                clock[COLOR_NB] = {base, base};
+        double                   white           = 0.5;
+
+        pos.set(fen, false, &states->back());
+        engines[0]->search_clear();
+        engines[1]->search_clear();
+
+        for (int ply = 0; ply < MaxPlies && !pos.is_draw(ply); ++ply)
+        {
+            const Color us = pos.side_to_move();
+
+            if (!MoveList<LEGAL>(pos).size())
+            {
+                if (pos.checkers())
+                    white = us == WHITE ? 0 : 1;
+                break;
+            }
+
+            // Engine 0 plays white in the even games
+            Engine&   engine = *engines[(us == WHITE) == (g % 2 == 0) ? 0 : 1];
+            TimeModel perturbed = model;
+            double    eOpt = offset(), eIter = offset();
+
+            for (double& s : perturbed.optimum)
+                s *= std::exp(eOpt);
+            for (double& s : perturbed.iteration)
+                s *= std::exp(eIter);
+            engine.get_time_model() = perturbed;
+
+            Search::LimitsType limits;
+            limits.time[WHITE] = clock[WHITE];
+            limits.time[BLACK] = clock[BLACK];
+            limits.inc[WHITE] = limits.inc[BLACK] = inc;
+            limits.startTime                      = now();
+
+            engine.set_position(fen, played);
+            engine.go(limits);
+            engine.wait_for_search_finished();
+
+            TimePoint elapsed = now() - limits.startTime;
+            auto [optimumCell, iterationCell] = engine.get_time_model_cells();
+
+            log << "move " << runId << '-' << g << ' ' << (us == WHITE ? 'w' : 'b') << ' '
+                << optimumCell << ' ' << eOpt << ' ' << iterationCell << ' ' << eIter << ' '
+                << elapsed << '\n';
+            used += elapsed, moves++;
+
+            if ((clock[us] -= elapsed) < 0)
+            {
+                white = us == WHITE ? 0 : 1;
+                break;
+            }
+            clock[us] += inc;
+
+            states->emplace_back();
+            pos.do_move(to_move(pos, bestmove), states->back());
+            played.push_back(bestmove);
+        }
+
+        log << "result " << runId << '-' << g << ' ' << white << std::endl;
+        std::cerr << "Game " << g + 1 << '/' << games << ": "
+                  << (white == 1 ? "1-0" : white == 0 ? "0-1" : "1/2-1/2") << " in "
+                  << played.size() << " plies" << std::endl;
+    }
+
+    sync_cout << "\n" << games << " games at " << base << "+" << inc << " ms, "
+              << used / std::max<TimePoint>(moves, 1) << " ms per move, logged to " << logFile
+              << sync_endl;
+}
+
+void time_fit(const std::string& logFile, const std::string& table, const std::string& output) {
+
+    // Cells with fewer samples keep their scale
+    constexpr std::size_t MinSamples = 50;
+    // Largest change of the log of a scale in one fit
+    constexpr double MaxStep = 0.1;
+
+    struct Sample {
+        std::string game;
+        bool        white;
+        double      offset;
+    };
+
+    TimeModel                          model;
+    std::map<std::string, double>      results;  // Score of white by game
+    std::vector<std::vector<Sample>>   optimum(TimeModel::OptimumCells),
+      iteration(TimeModel::IterationCells);
+
+    if (!table.empty() && !model.load(table))
+    {
+        sync_cout << "Failed to load the time model " << table << sync_endl;
+        return;
+    }
+
+    std::ifstream log(logFile);
+    for (std::string line; std::getline(log, line);)
+    {
+        std::istringstream is(line);
+        std::string        kind, game, color;
+        int                optimumCell, iterationCell;
+        double             eOpt, eIter, score;
+
+        if (is >> kind >> game && kind == "result" && is >> score)
+            results[game] = score;
+
+        else if (kind == "move" && is >> color >> optimumCell >> eOpt >> iterationCell >> eIter)
+        {
+            if (optimumCell >= 0 && optimumCell < TimeModel::OptimumCells)
+                optimum[optimumCell].push_back({game, color == "w", eOpt});
+            if (iterationCell >= 0 && iterationCell < TimeModel::IterationCells)
+                iteration[iterationCell].push_back({game, color == "w", eIter});
+        }
+    }
+
+    // Regresses the score of the side to move on the offset of the log of the
+    // scale, and moves the scale along the slope when it is significant
+    auto fit = [&](const std::vector<Sample>& samples, double& scale, const std::string& cell) {
+        std::vector<std::pair<double, double>> points;
+        for (const auto& s : samples)
+            if (auto it = results.find(s.game); it != results.end())
+                points.emplace_back(s.offset, s.white ? it->second : 1 - it->second);
+
+        if (points.size() < MinSamples)
+            return;
+
+        double n = double(points.size()), mx = 0, my = 0, sxx = 0, sxy = 0, syy = 0;
+        for (const auto& [x, y] : points)
+            mx += x / n, my += y / n;
+        for (const auto& [x, y] : points)
+            sxx += (x - mx) * (x - mx), sxy += (x - mx) * (y - my), syy += (y - my) * (y - my);
+
+        if (sxx <= 0)
+            return;
+
+        double slope  = sxy / sxx;
+        double error = std::sqrt(std::max(syy - slope * sxy, 0.0) / (n - 2) / sxx);
+
+        if (std::abs(slope) <= 2 * error)
+            return;
+
+        double old = scale;
+        scale      = std::clamp(scale * std::exp(std::clamp(slope, -MaxStep, MaxStep)), 0.1, 10.0);
+
+        sync_cout << std::fixed << std::setprecision(3) << std::left << std::setw(20) << cell
+                  << std::right << std::setw(8) << points.size() << " samples, slope "
+                  << std::setw(7) << slope << " +- " << error << ", scale " << old << " -> "
+                  << scale << sync_endl;
+    };
+
+    // Cells are named by the bucket indices of their keys, as in the table
+    constexpr int Plies   = int(TimeModel::Plies.size()) + 1;
+    constexpr int Ratios  = int(TimeModel::ClockRatios.size()) + 1;
+    constexpr int Efforts = int(TimeModel::Efforts.size()) + 1;
+
+    for (int i = 0; i < TimeModel::OptimumCells; ++i)
+        fit(optimum[i], model.optimum[i],
+            "optimum " + std::to_string(i / (Plies * Ratios)) + " "
+              + std::to_string(i / Ratios % Plies) + " " + std::to_string(i % Ratios));
+
+    for (int i = 0; i < TimeModel::IterationCells; ++i)
+        fit(iteration[i], model.iteration[i],
+            "iteration " + std::to_string(i / Efforts) + " " + std::to_string(i % Efforts));
+
+    if (!model.save(output))
+        sync_cout << "Failed to write " << output << sync_endl;
+    else
+        sync_cout << results.size() << " games, time model written to " << output << sync_endl;
+}
+
+void tb_init(const std::string& paths) {
+
+    for (const char* name : {"first", "unchanged directories"})
+    {
+        Tablebases::init("");  // Drop the tables so that the paths are scanned again
+
+        auto start = std::chrono::steady_clock::now();
+        Tablebases::init(paths);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        sync_cout << "Tablebase init (" << name << "): " << std::fixed << std::setprecision(2)
+                  << std::chrono::duration<double, std::milli>(elapsed).count() << " ms"
+                  << sync_endl;
+    }
+}
+
+int run(const std::string& binaryPath, const std::vector<std::string>& args) {
+
+    if (args.empty())
+    {
+        std::cerr << "Usage: stockfish --bench <search|evalcache|history|sharedhistory|placement"
+                     "|prefetch|ttstats|ttfront|deterministic|evalbatch|netload|movegen|perft"
+                     "|movepick|setup|skill|tbinit|tbprobe|timeplay|timefit|trace>"
+                     " [args...]"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const std::string& name = args[0];
+
+    if (name == "search" || name == "evalcache" || name == "history" || name == "placement"
+        || name == "prefetch" || name == "ttstats")
+    {
+        // search|evalcache|history|placement|prefetch|ttstats [depth] [threads] [hash]
+        Engine engine(binaryPath);
+        engine.get_options()["Threads"] = args.size() > 2 ? args[2] : "1";
+        engine.get_options()["Hash"]    = args.size() > 3 ? args[3] : "16";
+        engine.set_on_verify_networks([](std::string_view msg) { sync_cout << msg << sync_endl; });
+
+        int depth = args.size() > 1 ? std::stoi(args[1]) : 13;
+        if (name == "search")
+            search(engine, depth);
+        else if (name == "evalcache")
+            eval_cache(engine, depth);
+        else if (name == "history")
+            compact_history(engine, depth);
+        else if (name == "prefetch")
+            prefetch_ahead(engine, depth);
+        else if (name == "ttstats")
+            tt_stats(engine, depth);
+        else
+            thread_placement(engine, depth);
+        return EXIT_SUCCESS;
+    }
+
+    if (name == "sharedhistory")
+    {
+        // sharedhistory [depth] [max threads] [hash]
+        int         depth = args.size() > 1 ? std::stoi(args[1]) : 13;
+        std::size_t maxThreads =
+          args.size() > 2 ? std::stoull(args[2]) : get_hardware_concurrency();
+
+        Engine engine(binaryPath);
+        engine.get_options()["Hash"] = args.size() > 3 ? args[3] : "64";
+        engine.set_on_verify_networks([](std::string_view msg) { sync_cout << msg << sync_endl; });
+        shared_history(engine, depth, std::max<std::size_t>(maxThreads, 1));
+        return EXIT_SUCCESS;
+    }
+
+    if (name == "ttfront")
+    {
+        // ttfront [depth] [threads] [hash MB...]
+        int depth = args.size() > 1 ? std::stoi(args[1]) : 13;
+        std::vector<std::string> hashSizes(args.begin() + std::min<std::size_t>(args.size(), 3),
+                                           args.end());
+        if (hashSizes.empty())
+            hashSizes = {"16", "256", "1024"};
+
+        Engine engine(binaryPath);
+        engine.get_options()["Threads"] = args.size() > 2 ? args[2] : "1";
+        engine.set_on_verify_networks([](std::string_view msg) { sync_cout << msg << sync_endl; });
+        tt_front(engine, depth, hashSizes);
+        return EXIT_SUCCESS;
+    }
+
+    if (name == "deterministic")
+    {
+        // deterministic [depth] [threads] [quantum]
+        int depth   = args.size() > 1 ? std::stoi(args[1]) : 13;
+        int quantum = args.size() > 3 ? std::stoi(args[3]) : 4096;
+
+        Engine engine(binaryPath);
+        engine.get_options()["Threads"] = args.size() > 2 ? args[2] : "4";
+        engine.set_on_verify_networks([](std::string_view msg) { sync_cout << msg << sync_endl; });
+        deterministic(engine, depth, std::max(quantum, 1));
+        return EXIT_SUCCESS;
+    }
+
+    if (name == "evalbatch")
+    {
+        // evalbatch [evals] [batch sizes...]
+        std::size_t      evals = args.size() > 1 ? std::stoull(args[1]) : 100000;
+        std::vector<int> batchSizes;
+
+        for (std::size_t i = 2; i < args.size(); ++i)
+            batchSizes.push_back(std::max(1, std::stoi(args[i])));
+
+        if (batchSizes.empty())
+            batchSizes = {1, 2, 4, 8, 16, 32, 64, 128, 256};
+
+        Engine engine(binaryPath);
+        engine.set_on_verify_networks([](std::string_view msg) { sync_cout << msg << sync_endl; });
+        engine.bench_eval_batch(evals, batchSizes);
+        return EXIT_SUCCESS;
+    }
+
+    if (name == "movegen")
+    {
+        // movegen [games] [depth] [seed]
+        int           games = args.size() > 1 ? std::stoi(args[1]) : 100;
+        int           depth = args.size() > 2 ? std::stoi(args[2]) : 2;
+        std::uint64_t seed  = args.size() > 3 ? std::stoull(args[3]) : 1070372;
+
+        return movegen(games, depth, seed) ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    if (name == "movepick")
+    {
+        // movepick [iterations]
+        return move_pick(args.size() > 1 ? std::stoi(args[1]) : 100) ? EXIT_FAILURE
+                                                                       : EXIT_SUCCESS;
+    }
+
+    if (name == "perft")
+    {
+        // perft [depth] [hash] [max threads]
+        int         depth  = args.size() > 1 ? std::stoi(args[1]) : 6;
+        std::size_t hashMB = args.size() > 2 ? std::stoull(args[2]) : 256;
+        std::size_t maxThreads =
+          args.size() > 3 ? std::stoull(args[3]) : get_hardware_concurrency();
+
+        Engine engine(binaryPath);
+        engine.get_options()["Hash"] = std::string("1");
+        engine.bench_perft(depth, hashMB, std::max<std::size_t>(maxThreads, 1));
+        return EXIT_SUCCESS;
+    }
+
+    if (name == "setup")
+    {
+        // setup [plies]
+        Engine engine(binaryPath);
+        engine.set_on_verify_networks([](std::string_view) {});
+        setup(engine, args.size() > 1 ? std::stoi(args[1]) : 120);
+        return EXIT_SUCCESS;
+    }
+
+    if (name == "skill")
+    {
+        // skill [games] [movetime] [level] [rescore level]
+        int games        = args.size() > 1 ? std::stoi(args[1]) : 20;
+        int movetime     = args.size() > 2 ? std::stoi(args[2]) : 100;
+        int level        = args.size() > 3 ? std::stoi(args[3]) : 5;
+        int rescoreLevel = args.size() > 4 ? std::stoi(args[4]) : level;
+
+        skill_match(binaryPath, games, movetime, std::clamp(level, 0, 19),
+                    std::clamp(rescoreLevel, 0, 19));
+        return EXIT_SUCCESS;
+    }
+
+    if (name == "tbinit" && args.size() > 1)
+    {
+        // tbinit <paths>
+        tb_init(args[1]);
+        return EXIT_SUCCESS;
+    }
+
+    if (name == "tbprobe" && args.size() > 1)
+    {
+        // tbprobe <paths> [depth] [none|warmup|cache|both]
+        int depth = args.size() > 2 ? std::stoi(args[2]) : 3;
+
+        if (args.size() > 3)
+        {
+            tb_probe(args[1], depth, args[3]);
+            return EXIT_SUCCESS;
+        }
+
+        for (const char* mode : {"none", "warmup", "cache", "both"})
+        {
+            evict_tb_files(args[1]);
+            std::string cmd = "\"" + binaryPath + "\" --bench tbprobe \"" + args[1] + "\" "
+                            + std::to_string(depth) + " " + mode;
+            if (std::system(cmd.c_str()) != 0)
+                return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    if (name == "timeplay")
+    {
+        // timeplay [games] [base ms] [inc ms] [noise] [log] [table]
+        int         games = args.size() > 1 ? std::stoi(args[1]) : 20;
+        int         base  = args.size() > 2 ? std::stoi(args[2]) : 10000;
+        int         inc   = args.size() > 3 ? std::stoi(args[3]) : 100;
+        double      noise = args.size() > 4 ? std::stod(args[4]) : 0.3;
+        std::string log   = args.size() > 5 ? args[5] : "timeplay.log";
+
+        time_play(binaryPath, games, base, inc, noise, log, args.size() > 6 ? args[6] : "");
+        return EXIT_SUCCESS;
+    }
+
+    if (name == "timefit" && args.size() > 1)
+    {
+        // timefit <log> [table] [output]
+        time_fit(args[1], args.size() > 2 ? args[2] : "",
+                 args.size() > 3 ? args[3] : "timemodel.txt");
+        return EXIT_SUCCESS;
+    }
+
+    if (name == "trace" && args.size() > 1)
+    {
+        // trace <files...>
+        Trace::report(std::vector<std::string>(args.begin() + 1, args.end()));
+        return EXIT_SUCCESS;
+    }
+
+    if (name == "netload")
+    {
+        // netload [cache directory]
+        net_load(binaryPath, args.size() > 1 ? args[1] : "nnue-cache");
+        return EXIT_SUCCESS;
+    }
+
+    std::cerr << "Unknown benchmark: " << name << std::endl;
+    return EXIT_FAILURE;
+}
+
+}  // namespace Stockfish::Benchmark
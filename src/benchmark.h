@@ -0,0 +1,161 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BENCHMARK_H_INCLUDED
+#define BENCHMARK_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Stockfish {
+
+class Engine;
+class ThreadPool;
+
+namespace Eval::NNUE {
+struct Networks;
+}
+
+namespace Benchmark {
+
+// Positions used by the throughput benchmarks
+extern const std::vector<std::string> Defaults;
+
+// Searches the default positions to the given depth and reports the total number
+// of nodes and the nodes per second, in the format of the upstream bench command.
+// Returns the number of nodes searched.
+std::uint64_t search(Engine& engine, int depth);
+
+// Runs the search benchmark without and with the eval cache, reporting the cache
+// hit rate and the nodes per second of both runs.
+void eval_cache(Engine& engine, int depth);
+
+// Runs the search benchmark with the default and the compact history layout, and
+// reports the memory footprint of the search threads, the time to reach the
+// depth and the nodes per second of both.
+void compact_history(Engine& engine, int depth);
+
+// Runs the search benchmark without and with the TT entries of the next one and
+// two moves of each move picker prefetched, and reports the nodes per second of
+// each. The effect shows with a hash much larger than the caches.
+void prefetch_ahead(Engine& engine, int depth);
+
+// Searches the default positions one after the other without clearing the hash
+// table, and reports after each the contents of the table and the probes, writes,
+// replacements and estimated key collisions of the search. Then prints the entries
+// of the whole table by age and by depth.
+void tt_stats(Engine& engine, int depth);
+
+// Searches the default positions without and with the front table of the hash table,
+// with each of the given hash sizes in MB, and reports the nodes per second, the gain
+// of the front table and the share of the probes answered by it.
+void tt_front(Engine& engine, int depth, const std::vector<std::string>& hashSizes);
+
+// Runs the search benchmark with 1, 2, 4, ... threads up to the maximum, each with
+// own and with shared histories, and reports the time to reach the depth and the
+// nodes per second of both.
+void shared_history(Engine& engine, int depth, std::size_t maxThreads);
+
+// Runs the search benchmark with each thread placement: left to the NUMA policy,
+// one thread per physical core first, and filling the SMT siblings of each core
+// first. Reports the nodes per second of each.
+void thread_placement(Engine& engine, int depth);
+
+// Evaluates the default positions with both networks, in batches of the given
+// sizes, and reports the number of evaluations per second for each size.
+void eval_batch(const Eval::NNUE::Networks& networks,
+                std::size_t                 evals,
+                const std::vector<int>&     batchSizes);
+
+// Reports the engine startup time, dominated by loading the networks, without
+// and with the cache of preprocessed networks in the given directory.
+void net_load(const std::string& binaryPath, const std::string& cacheDirectory);
+
+// Searches the default positions to the given depth twice with the normal
+// multithreaded search and twice with the deterministic one at the given quantum.
+// Reports the nodes per second of each mode and the number of positions whose
+// best move or node count differ between its two runs.
+void deterministic(Engine& engine, int depth, int quantum);
+
+// Reports the latency percentiles of tablebase probes in the endgames of the
+// default positions, walking their move trees to the given depth, with the
+// tables in the given paths. The mode is one of none, warmup, cache or both;
+// without a mode each of them runs in a child process, with cold file pages.
+void tb_probe(const std::string& paths, int depth, const std::string& mode);
+
+// Cross-checks generate<LEGAL> against the reference generate<LEGAL_FILTERED> in
+// the move trees, to the given depth, of the positions of random games, then
+// reports the perft speed of both generators. Returns the number of mismatches.
+std::uint64_t movegen(int games, int depth, std::uint64_t seed);
+
+// Cross-checks the move order of the scalar and the vectorized move picker in the
+// positions of random games with random histories, then reports the time per
+// next_move() of both, emitting all the moves and only the first three of them.
+// Returns the number of mismatches.
+std::uint64_t move_pick(int iterations);
+
+// Runs the parallel perft of the move generator check positions to the given
+// depth with all the threads of the pool, and reports the number of leaf nodes
+// per second. Uses a new perft table of the given size, none if zero.
+void perft_threads(ThreadPool& threads, int depth, std::size_t hashMB);
+
+// Replays a random game of the given length the way the agent sets up positions,
+// from the start position and the full move list at every ply, and reports the
+// number of heap allocations per move, with and without a depth 1 search.
+void setup(Engine& engine, int plies);
+
+// Plays games at the given time per move between an engine that rescores the Skill
+// candidates at rescoreLevel and one that runs the MultiPV search at level, from the
+// default positions with both colors. Reports the result, its Elo difference and
+// the average depth reached by each.
+void skill_match(
+  const std::string& binaryPath, int games, int movetime, int level, int rescoreLevel);
+
+// Plays self-play games at the given clock, base and increment in milliseconds,
+// with the time model of the given table, the formulas if empty. Before each
+// move, the logs of all the scales of the moving engine are offset by a random
+// amount up to the noise. Appends the cells used and the offsets of each move,
+// and the result of each game, to the log file for time_fit().
+void time_play(const std::string& binaryPath,
+               int                games,
+               int                base,
+               int                inc,
+               double             noise,
+               const std::string& logFile,
+               const std::string& table);
+
+// Fits the time model of the given table, the formulas if empty, to the games of
+// a time_play() log: the scale of each cell with enough moves follows the slope
+// of the score on the offset of its log, when significant. Prints the changed
+// cells and writes the new table to the output path.
+void time_fit(const std::string& logFile, const std::string& table, const std::string& output);
+
+// Reports the time to initialize the tablebases in the given paths, first and
+// again with the directory listings of the first initialization.
+void tb_init(const std::string& paths);
+
+// Entry point of "stockfish --bench <name> [args...]". Returns the process
+// exit code.
+int run(const std::string& binaryPath, const std::vector<std::string>& args);
+
+}  // namespace Benchmark
+}  // namespace Stockfish
+
+#endif  // #ifndef BENCHMARK_H_INCLUDED
@@ -0,0 +1,152 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Launcher of a dispatch build (make dispatch-build). The SIMD code paths of the
+// engine, and the layout of the network weights they work on, are fixed at compile
+// time by ARCH, so the engine is built once per x86-64 architecture level as
+// stockfish-<arch>. This launcher reads CPUID at startup and executes the fastest
+// of those binaries the host can run, with the same arguments.
+//
+// Standalone on purpose: it must run on any x86-64 host, so it does not link
+// against the engine and is compiled without any ARCH specific flags.
+
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+struct Variant {
+    const char* arch;
+    bool (*supported)();
+};
+
+// Same rule as scripts/get_native_properties.sh: pext is microcoded, and thus
+// very slow, on AMD Zen 1 and Zen 2 (family 17h).
+bool fast_pext() { return __builtin_cpu_supports("bmi2") && !__builtin_cpu_is("amdfam17h"); }
+
+bool avx2() {
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi")
+        && __builtin_cpu_supports("popcnt") && __builtin_cpu_supports("sse4.1");
+}
+
+bool avx512() {
+    return avx2() && fast_pext() && __builtin_cpu_supports("avx512f")
+        && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512dq")
+        && __builtin_cpu_supports("avx512vl");
+}
+
+// Best first, the order in which get_native_properties.sh picks an ARCH
+const Variant Variants[] = {
+  {"x86-64-avx512icl",
+   [] {
+       return avx512() && __builtin_cpu_supports("avx512cd")
+           && __builtin_cpu_supports("avx512ifma") && __builtin_cpu_supports("avx512vbmi")
+           && __builtin_cpu_supports("avx512vbmi2") && __builtin_cpu_supports("avx512vpopcntdq")
+           && __builtin_cpu_supports("avx512bitalg") && __builtin_cpu_supports("avx512vnni")
+           && __builtin_cpu_supports("vpclmulqdq") && __builtin_cpu_supports("gfni")
+           && __builtin_cpu_supports("vaes");
+   }},
+  {"x86-64-vnni512", [] { return avx512() && __builtin_cpu_supports("avx512vnni"); }},
+  {"x86-64-avx512", [] { return avx512(); }},
+  {"x86-64-avxvnni", [] { return avx2() && fast_pext() && __builtin_cpu_supports("avxvnni"); }},
+  {"x86-64-bmi2", [] { return avx2() && fast_pext(); }},
+  {"x86-64-avx2", [] { return avx2(); }},
+  {"x86-64-sse41-popcnt",
+   [] {
+       return __builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("ssse3")
+           && __builtin_cpu_supports("popcnt");
+   }},
+  {"x86-64", [] { return true; }},
+};
+
+const Variant* find_variant(const std::string& arch) {
+    for (const auto& v : Variants)
+        if (arch == v.arch)
+            return &v;
+    return nullptr;
+}
+
+std::string executable_directory() {
+    char    buf[PATH_MAX];
+    ssize_t len = readlink("/proc/self/exe", buf, sizeof(buf) - 1);
+    if (len <= 0)
+        return ".";
+
+    std::string path(buf, len);
+    return path.substr(0, path.find_last_of('/'));
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+
+    __builtin_cpu_init();
+
+    // Used by the Makefile to decide which variants can be profiled on the build host
+    if (argc == 3 && std::strcmp(argv[1], "--dispatch-supports") == 0)
+    {
+        const Variant* v = find_variant(argv[2]);
+        return v && v->supported() ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    const std::string dir = executable_directory();
+    std::string       path;
+
+    // STOCKFISH_ARCH pins a variant, e.g. to compare them on the same host
+    if (const char* forced = std::getenv("STOCKFISH_ARCH"); forced && *forced)
+    {
+        if (!find_variant(forced))
+        {
+            std::cerr << "Unknown STOCKFISH_ARCH: " << forced << std::endl;
+            return EXIT_FAILURE;
+        }
+        path = dir + "/stockfish-" + forced;
+    }
+    else
+        for (const auto& v : Variants)
+            if (v.supported() && access((dir + "/stockfish-" + v.arch).c_str(), X_OK) == 0)
+            {
+                path = dir + "/stockfish-" + v.arch;
+                break;
+            }
+
+    if (argc == 2 && std::strcmp(argv[1], "--dispatch-arch") == 0)
+    {
+        std::cout << (path.empty() ? "none" : path.substr(dir.size() + 11)) << std::endl;
+        return path.empty() ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    if (path.empty())
+    {
+        std::cerr << "No stockfish-<arch> binary for this CPU next to " << argv[0] << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<char*> args(argv, argv + argc + 1);
+    args[0] = path.data();
+    execv(path.c_str(), args.data());
+
+    std::cerr << "Failed to execute " << path << ": " << std::strerror(errno) << std::endl;
+    return EXIT_FAILURE;
+}
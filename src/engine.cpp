@@ -21,6 +21,7 @@
 #include <algorithm>
 #include <cassert>
 #include <deque>
+#include <iomanip>
 #include <iosfwd>
 #include <memory>
 #include <ostream>
@@ -29,6 +30,7 @@
 #include <utility>
 #include <vector>
 
+#include "benchmark.h"
 #include "evaluate.h"
 #include "misc.h"
 #include "nnue/network.h"
@@ -51,10 +53,11 @@ constexpr auto StartFEN   = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq
 constexpr int  MaxHashMB  = Is64Bit ? 33554432 : 2048;
 int            MaxThreads = std::max(1024, 4 * int(get_hardware_concurrency()));
 
-Engine::Engine(std::optional<std::string> path) :
+Engine::Engine(std::optional<std::string> path, std::string nnueCacheDir) :
     binaryDirectory(path ? CommandLine::get_binary_directory(*path) : ""),
+    nnueCacheDirectory(std::move(nnueCacheDir)),
     numaContext(NumaConfig::from_system()),
-    states(new std::deque<StateInfo>(1)),
+    states(make_state_list()),
     threads(),
     networks(
       numaContext,
@@ -64,6 +67,7 @@ Engine::Engine(std::optional<std::string> path) :
                                          NN::EmbeddedNNUEType::BIG),
         std::make_unique<NN::NetworkSmall>(NN::EvalFile{EvalFileDefaultNameSmall, "None", ""},
                                            NN::EmbeddedNNUEType::SMALL))),
+    sharedHistories(numaContext),
     network_verified(false) {
 
     pos.set(StartFEN, false, &states->back());
@@ -87,6 +91,31 @@ Engine::Engine(std::optional<std::string> path) :
           return thread_allocation_information_as_string();
       }));
 
+    options.add(  //
+      "ThreadPlacement",
+      Option("numa var numa var cores var siblings", "numa", [this](const Option&) {
+          resize_threads();
+          return thread_allocation_information_as_string();
+      }));
+
+    options.add(  //
+      "ReservedCores", Option(0, 0, MaxThreads, [this](const Option&) {
+          resize_threads();
+          return std::nullopt;
+      }));
+
+    options.add(  //
+      "ExclusiveCores", Option(false, [this](const Option&) {
+          resize_threads();
+          return std::nullopt;
+      }));
+
+    options.add(  //
+      "CoreLockDir", Option("/tmp", [this](const Option&) {
+          resize_threads();
+          return std::nullopt;
+      }));
+
     options.add(  //
       "Hash", Option(16, 1, MaxHashMB, [this](const Option& o) {
           set_tt_size(o);
@@ -119,8 +148,51 @@ Engine::Engine(std::optional<std::string> path) :
                 Option(Stockfish::Search::Skill::LowestElo, Stockfish::Search::Skill::LowestElo,
                        Stockfish::Search::Skill::HighestElo));
 
+    options.add("SkillRescore", Option(false));
+
     options.add("ShowWDL", Option(false));
 
+    options.add("EvalCache", Option(false));
+
+    options.add("TTFront", Option(false));
+
+    options.add("DeterministicQuantum", Option(0, 0, 1000000));
+
+    options.add(  //
+      "TimeModel", Option("", [this](const Option& o) -> std::optional<std::string> {
+          if (std::string(o).empty())
+              timeModel.reset();
+          else if (!timeModel.load(o))
+              return "Failed to load the time model " + std::string(o) + ", using the formulas";
+          return std::nullopt;
+      }));
+
+#ifdef USE_TRACE
+    options.add("TraceFile", Option("search.trace"));
+#endif
+
+    options.add(  //
+      "CompactHistory", Option(false, [this](const Option& o) {
+          threads.wait_for_search_finished();
+          sharedHistories =
+            SharedHistoryTables(bool(options["SharedHistory"]), pawn_history_size(bool(o)));
+          resize_threads();
+          return std::nullopt;
+      }));
+
+    options.add(  //
+      "SharedHistory", Option(false, [this](const Option& o) {
+          threads.wait_for_search_finished();
+          sharedHistories =
+            SharedHistoryTables(bool(o), pawn_history_size(bool(options["CompactHistory"])));
+          resize_threads();
+          return std::nullopt;
+      }));
+
+    options.add("VectorMovePicker", Option(false));
+
+    options.add("TTPrefetchAhead", Option(0, 0, 2));
+
     options.add(  //
       "SyzygyPath", Option("", [](const Option& o) {
           Tablebases::init(o);
@@ -133,6 +205,12 @@ Engine::Engine(std::optional<std::string> path) :
 
     options.add("SyzygyProbeLimit", Option(7, 0, 7));
 
+    options.add("SyzygyWarmup", Option(false));
+
+    options.add("SyzygyPin", Option(false));
+
+    options.add("SyzygyProbeCache", Option(false));
+
     options.add(  //
       "EvalFile", Option(EvalFileDefaultNameBig, [this](const Option& o) {
           load_big_network(o);
@@ -155,7 +233,30 @@ std::uint64_t Engine::perft(const std::string& fen, Depth depth, bool isChess960
         network_verified = true;
     }
 
-    return Benchmark::perft(fen, depth, isChess960);
+    Benchmark::PerftTable table{Benchmark::PerftTable::DefaultMB};
+    return Benchmark::perft(threads, fen, depth, isChess960, &table, true);
+}
+
+void Engine::bench_perft(Depth depth, std::size_t hashMB, std::size_t maxThreads) {
+
+    for (std::size_t n = 1;; n = std::min(n * 2, maxThreads))
+    {
+        options["Threads"] = std::to_string(n);
+        Benchmark::perft_threads(threads, depth, hashMB);
+
+        if (n == maxThreads)
+            break;
+    }
+}
+
+void Engine::bench_eval_batch(std::size_t evals, const std::vector<int>& batchSizes) {
+    if (!network_verified)
+    {
+        verify_networks();
+        network_verified = true;
+    }
+
+    Benchmark::eval_batch(*networks, evals, batchSizes);
 }
 
 void Engine::go(Search::LimitsType& limits) {
@@ -163,8 +264,8 @@ void Engine::go(Search::LimitsType& limits) {
     if (!network_verified) {
         verify_networks();
         network_verified = true;
+        sync_cout << "Network verification complete. Starting threads..." << sync_endl;
     }
-    std::cout << "Network verification complete. Starting threads..." << std::endl;
 
     threads.start_thinking(options, pos, states, limits);
 }
@@ -175,9 +276,6 @@ void Engine::search_clear() {
 
     tt.clear(threads);
     threads.clear();
-
-    // @TODO wont work with multiple instances
-    Tablebases::init(options["SyzygyPath"]);  // Free mapped files
 }
 
 void Engine::set_on_update_no_moves(std::function<void(const Engine::InfoShort&)>&& f) {
@@ -204,7 +302,7 @@ void Engine::wait_for_search_finished() { threads.main_thread()->wait_for_search
 
 void Engine::set_position(const std::string& fen, const std::vector<std::string>& moves) {
     // Drop the old state and create a new one
-    states = StateListPtr(new std::deque<StateInfo>(1));
+    states = make_state_list();
     pos.set(fen, options["Chess960"], &states->back());
 
     for (const auto& move : moves)
@@ -220,7 +318,7 @@ void Engine::set_position(const std::string& fen, const std::vector<std::string>
 }
 
 void Engine::reset() {
-    states = StateListPtr(new std::deque<StateInfo>(1));
+    states = make_state_list();
     pos.set(StartFEN, options["Chess960"], &states->back());
 }
 
@@ -260,7 +358,8 @@ void Engine::set_numa_config_from_option(const std::string& o) {
 
 void Engine::resize_threads() {
     threads.wait_for_search_finished();
-    threads.set(numaContext.get_numa_config(), {options, threads, tt, networks}, updateContext);
+    threads.set(numaContext.get_numa_config(),
+                {options, threads, tt, networks, sharedHistories, timeModel}, updateContext);
 
     // Reallocate the hash with the new threadpool size
     set_tt_size(options["Hash"]);
@@ -313,23 +412,25 @@ void Engine::verify_networks() const {
 
 void Engine::load_networks() {
     networks.modify_and_replicate([this](NN::Networks& networks_) {
-        networks_.big.load(binaryDirectory, options["EvalFile"]);
-        networks_.small.load(binaryDirectory, options["EvalFileSmall"]);
+        networks_.big.load(binaryDirectory, options["EvalFile"], nnueCacheDirectory);
+        networks_.small.load(binaryDirectory, options["EvalFileSmall"], nnueCacheDirectory);
     });
     threads.clear();
     threads.ensure_network_replicated();
 }
 
 void Engine::load_big_network(const std::string& file) {
-    networks.modify_and_replicate(
-      [this, &file](NN::Networks& networks_) { networks_.big.load(binaryDirectory, file); });
+    networks.modify_and_replicate([this, &file](NN::Networks& networks_) {
+        networks_.big.load(binaryDirectory, file, nnueCacheDirectory);
+    });
     threads.clear();
     threads.ensure_network_replicated();
 }
 
 void Engine::load_small_network(const std::string& file) {
-    networks.modify_and_replicate(
-      [this, &file](NN::Networks& networks_) { networks_.small.load(binaryDirectory, file); });
+    networks.modify_and_replicate([this, &file](NN::Networks& networks_) {
+        networks_.small.load(binaryDirectory, file, nnueCacheDirectory);
+    });
     threads.clear();
     threads.ensure_network_replicated();
 }
@@ -344,7 +445,7 @@ void Engine::save_network(const std::pair<std::optional<std::string>, std::strin
 // utility functions
 
 void Engine::trace_eval() const {
-    StateListPtr trace_states(new std::deque<StateInfo>(1));
+    StateListPtr trace_states = make_state_list();
     Position     p;
     p.set(pos.fen(), options["Chess960"], &trace_states->back());
 
@@ -370,6 +471,32 @@ std::string Engine::visualize() const {
 
 int Engine::get_hashfull(int maxAge) const { return tt.hashfull(maxAge); }
 
+Eval::NNUE::EvalCache::Stats Engine::get_eval_cache_stats() const {
+    return threads.eval_cache_stats();
+}
+
+ThreatStats Engine::get_threat_stats() const { return threads.threat_stats(); }
+
+TTOccupancy Engine::get_tt_occupancy(std::size_t maxClusters) const {
+    return tt.occupancy(maxClusters);
+}
+
+TTCounters Engine::get_tt_counters() const { return threads.tt_counters(); }
+
+TimeModel& Engine::get_time_model() { return timeModel; }
+
+std::pair<int, int> Engine::get_time_model_cells() {
+    const TimeManagement& tm = threads.main_manager()->tm;
+    return {tm.optimumCell, tm.iterationCell};
+}
+
+std::pair<std::string, std::string> Engine::get_best_move_so_far() const {
+    auto [best, ponder] = threads.best_move_so_far();
+
+    return {best ? move_to_string(best, pos.is_chess960()) : "",
+            ponder ? move_to_string(ponder, pos.is_chess960()) : ""};
+}
+
 std::vector<std::pair<size_t, size_t>> Engine::get_bound_thread_count_by_numa_node() const {
     auto                                   counts = threads.get_bound_thread_count_by_numa_node();
     const NumaConfig&                      cfg    = numaContext.get_numa_config();
@@ -411,6 +538,74 @@ std::string Engine::thread_binding_information_as_string() const {
     return ss.str();
 }
 
+std::string Engine::memory_footprint_as_string() const {
+    std::stringstream ss;
+    size_t            total = 0;
+
+    ss << "Memory per search thread:";
+    for (const auto& [name, bytes] : threads.main_thread()->worker->footprint())
+    {
+        ss << "\n  " << std::left << std::setw(32) << name << std::right << std::setw(8)
+           << (bytes + 1023) / 1024 << " KB";
+        total += bytes;
+    }
+
+    ss << "\n  " << std::left << std::setw(32) << "Total" << std::right << std::setw(8)
+       << (total + 1023) / 1024 << " KB"
+       << "\nSearch threads: " << threads.size() << " x " << (total + 1023) / 1024 << " KB = "
+       << (threads.size() * total + (1 << 20) - 1) / (1 << 20)
+       << " MB, hash: " << int(options["Hash"]) << " MB";
+
+    if (const SharedHistories* shared = threads.main_thread()->worker->sharedHistories)
+        ss << "\nShared histories: " << (shared->footprint() + 1023) / 1024
+           << " KB per NUMA node";
+
+    return ss.str();
+}
+
+std::string Engine::tt_stats_as_string(std::size_t maxClusters) const {
+    const TTOccupancy o = tt.occupancy(maxClusters);
+    const TTCounters  c = threads.tt_counters();
+    std::stringstream ss;
+
+    auto ratio = [](double n, std::uint64_t d) { return d ? n / double(d) : 0.0; };
+
+    // Ages and depths in a few buckets, as fractions of the occupied entries. Entries
+    // of unsearched nodes only keep a static evaluation.
+    std::uint64_t ages[4]{}, depths[7]{};
+    for (std::size_t i = 0; i < o.age.size(); ++i)
+        ages[std::min<std::size_t>(i, 3)] += o.age[i];
+    for (std::size_t i = 0; i < o.depth.size(); ++i)
+    {
+        int d = int(i) + DEPTH_ENTRY_OFFSET;
+        depths[d == DEPTH_UNSEARCHED ? 0 : d <= 0 ? 1 : std::min((d + 4) / 5 + 1, 6)] += o.depth[i];
+    }
+
+    ss << std::setprecision(4) << "TT entries=" << o.entries
+       << " occupied=" << ratio(o.occupied, o.entries) << " pv=" << ratio(o.pv, o.occupied)
+       << " none=" << ratio(o.bound[BOUND_NONE], o.occupied)
+       << " upper=" << ratio(o.bound[BOUND_UPPER], o.occupied)
+       << " lower=" << ratio(o.bound[BOUND_LOWER], o.occupied)
+       << " exact=" << ratio(o.bound[BOUND_EXACT], o.occupied);
+
+    const char* ageNames[] = {"age0", "age1", "age2", "age3+"};
+    for (int i = 0; i < 4; ++i)
+        ss << ' ' << ageNames[i] << '=' << ratio(ages[i], o.occupied);
+
+    const char* depthNames[] = {"unsearched", "depth_qs",   "depth1_5", "depth6_10",
+                                "depth11_15", "depth16_20", "depth21+"};
+    for (int i = 0; i < 7; ++i)
+        ss << ' ' << depthNames[i] << '=' << ratio(depths[i], o.occupied);
+
+    ss << " probes=" << c.probes << " hits=" << ratio(c.hits, c.probes)
+       << " front_hits=" << ratio(c.frontHits, c.probes) << " writes=" << c.writes
+       << " replaced=" << ratio(c.replaced, c.writes)
+       << " replaced_current=" << ratio(c.replacedCurrent, c.writes)
+       << " collisions=" << ratio(c.collisions(), c.probes);
+
+    return ss.str();
+}
+
 std::string Engine::thread_allocation_information_as_string() const {
     std::stringstream ss;
 
@@ -424,6 +619,11 @@ std::string Engine::thread_allocation_information_as_string() const {
     ss << " with NUMA node thread binding: ";
     ss << boundThreadsByNodeStr;
 
+    const Option& placement = options["ThreadPlacement"];
+    if (placement == "cores" || placement == "siblings")
+        ss << ", one processor per thread (" << (placement == "cores" ? "cores" : "siblings")
+           << ")";
+
     return ss.str();
 }
 }
@@ -46,7 +46,9 @@ class Engine {
     using InfoFull  = Search::InfoFull;
     using InfoIter  = Search::InfoIteration;
 
-    Engine(std::optional<std::string> path = std::nullopt);
+    // A non-empty nnueCacheDir enables the cache of preprocessed networks, so
+    // that later engines and processes skip parsing the network files.
+    Engine(std::optional<std::string> path = std::nullopt, std::string nnueCacheDir = "");
 
     // Cannot be movable due to components holding backreferences to fields
     Engine(const Engine&)            = delete;
@@ -57,6 +59,8 @@ class Engine {
     ~Engine() { wait_for_search_finished(); }
 
     std::uint64_t perft(const std::string& fen, Depth depth, bool isChess960);
+    void          bench_perft(Depth depth, std::size_t hashMB, std::size_t maxThreads);
+    void          bench_eval_batch(std::size_t evals, const std::vector<int>& batchSizes);
 
     // non blocking call to start searching
     void go(Search::LimitsType&);
@@ -103,6 +107,24 @@ class Engine {
 
     int get_hashfull(int maxAge = 0) const;
 
+    Eval::NNUE::EvalCache::Stats get_eval_cache_stats() const;
+    ThreatStats                  get_threat_stats() const;
+
+    // Contents of the hash table, of its first clusters or all of them with 0, and the
+    // probes and writes of the last search. The string is one line of key=value pairs.
+    TTOccupancy get_tt_occupancy(std::size_t maxClusters = 0) const;
+    TTCounters  get_tt_counters() const;
+    std::string tt_stats_as_string(std::size_t maxClusters = 0) const;
+
+    // Best and ponder move of the running search so far, see ThreadPool::publish_best_move().
+    // The best move is empty without legal moves, the ponder move when unknown.
+    std::pair<std::string, std::string> get_best_move_so_far() const;
+
+    // The table of the TimeModel option, and the cells of it used by the last
+    // search with time management, -1 when not used.
+    TimeModel&          get_time_model();
+    std::pair<int, int> get_time_model_cells();
+
     std::string                            fen() const;
     void                                   flip();
     std::string                            visualize() const;
@@ -111,11 +133,13 @@ class Engine {
     std::string                            numa_config_information_as_string() const;
     std::string                            thread_allocation_information_as_string() const;
     std::string                            thread_binding_information_as_string() const;
+    std::string                            memory_footprint_as_string() const;
 
     friend class PonderTest;
 
    private:
     const std::string binaryDirectory;
+    const std::string nnueCacheDirectory;
 
     NumaReplicationContext numaContext;
 
@@ -126,6 +150,8 @@ class Engine {
     ThreadPool                                         threads;
     TranspositionTable                                 tt;
     LazyNumaReplicatedSystemWide<Eval::NNUE::Networks> networks;
+    NumaReplicated<SharedHistoryTables>                sharedHistories;
+    TimeModel                                          timeModel;
 
     Search::SearchManager::UpdateContext  updateContext;
     std::function<void(std::string_view)> onVerifyNetworks;
@@ -28,6 +28,7 @@
 #include <sstream>
 #include <tuple>
 
+#include "nnue/eval_cache.h"
 #include "nnue/network.h"
 #include "nnue/nnue_misc.h"
 #include "position.h"
@@ -47,26 +48,58 @@ int Eval::simple_eval(const Position& pos) {
 
 bool Eval::use_smallnet(const Position& pos) { return std::abs(simple_eval(pos)) > 962; }
 
+namespace {
+
+// Runs one of the networks, or takes its output from the eval cache if given one
+template<typename Network, typename Cache>
+Eval::NNUE::NetworkOutput evaluate_network(const Network&                network,
+                                           Eval::NNUE::EmbeddedNNUEType  type,
+                                           const Position&               pos,
+                                           Eval::NNUE::AccumulatorStack& accumulators,
+                                           Cache&                        cache,
+                                           Eval::NNUE::EvalCache*        evalCache) {
+
+    Eval::NNUE::NetworkOutput output;
+
+    if (evalCache && evalCache->probe(type, pos.key(), output))
+        return output;
+
+    output = network.evaluate(pos, accumulators, cache);
+
+    if (evalCache)
+        evalCache->store(type, pos.key(), output);
+
+    return output;
+}
+
+}  // namespace
+
 // Evaluate is the evaluator for the outer world. It returns a static evaluation
 // of the position from the point of view of the side to move.
 Value Eval::evaluate(const Eval::NNUE::Networks&    networks,
                      const Position&                pos,
                      Eval::NNUE::AccumulatorStack&  accumulators,
                      Eval::NNUE::AccumulatorCaches& caches,
-                     int                            optimism) {
+                     int                            optimism,
+                     Eval::NNUE::EvalCache*         evalCache) {
 
     assert(!pos.checkers());
 
+    using Eval::NNUE::EmbeddedNNUEType;
+
     bool smallNet           = use_smallnet(pos);
-    auto [psqt, positional] = smallNet ? networks.small.evaluate(pos, accumulators, caches.small)
-                                       : networks.big.evaluate(pos, accumulators, caches.big);
+    auto [psqt, positional] = smallNet ? evaluate_network(networks.small, EmbeddedNNUEType::SMALL,
+                                                          pos, accumulators, caches.small, evalCache)
+                                       : evaluate_network(networks.big, EmbeddedNNUEType::BIG, pos,
+                                                          accumulators, caches.big, evalCache);
 
     Value nnue = (125 * psqt + 131 * positional) / 128;
 
     // Re-evaluate the position when higher eval accuracy is worth the time spent
     if (smallNet && (std::abs(nnue) < 277))
     {
-        std::tie(psqt, positional) = networks.big.evaluate(pos, accumulators, caches.big);
+        std::tie(psqt, positional) = evaluate_network(networks.big, EmbeddedNNUEType::BIG, pos,
+                                                      accumulators, caches.big, evalCache);
         nnue                       = (125 * psqt + 131 * positional) / 128;
         smallNet                   = false;
     }
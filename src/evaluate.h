@@ -40,6 +40,7 @@ namespace NNUE {
 struct Networks;
 struct AccumulatorCaches;
 class AccumulatorStack;
+class EvalCache;
 }
 
 std::string trace(Position& pos, const Eval::NNUE::Networks& networks);
@@ -50,7 +51,8 @@ Value evaluate(const NNUE::Networks&          networks,
                const Position&                pos,
                Eval::NNUE::AccumulatorStack&  accumulators,
                Eval::NNUE::AccumulatorCaches& caches,
-               int                            optimism);
+               int                            optimism,
+               Eval::NNUE::EvalCache*         evalCache = nullptr);
 }  // namespace Eval
 
 }  // namespace Stockfish
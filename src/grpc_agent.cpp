@@ -30,24 +30,61 @@ GrpcAgent::GrpcAgent(const AgentConfig& cfg) : config(cfg) {
     channel = grpc::CreateChannel(target, creds);
     stub = chess_contest::ChessGame::NewStub(channel);
     
-    engine.emplace();
+    engine.emplace(std::nullopt, config.nnue_cache_dir);
     // Set engine options from config
     engine->get_options()["Skill Level"] = std::to_string(config.skill_level);
     engine->get_options()["LimitStrength"] = config.limit_strength ? std::string("true") : std::string("false");
     engine->get_options()["Elo"] = std::to_string(config.elo);
+    engine->get_options()["SkillRescore"] = config.skill_rescore ? std::string("true") : std::string("false");
     engine->get_options()["Hash"] = std::to_string(config.hash);
     engine->get_options()["Ponder"] = config.ponder ? std::string("true") : std::string("false");
     engine->get_options()["MultiPV"] = std::to_string(config.multi_pv);
     engine->get_options()["Threads"] = std::to_string(config.threads);
+    engine->get_options()["ThreadPlacement"] = config.thread_placement;
+    engine->get_options()["ReservedCores"] = std::to_string(config.reserved_cores);
+    engine->get_options()["ExclusiveCores"] = config.exclusive_cores ? std::string("true") : std::string("false");
+    engine->get_options()["CoreLockDir"] = config.core_lock_dir;
+    engine->get_options()["EvalCache"] = config.eval_cache ? std::string("true") : std::string("false");
+    engine->get_options()["VectorMovePicker"] = config.vector_move_picker ? std::string("true") : std::string("false");
+    engine->get_options()["TTPrefetchAhead"] = std::to_string(config.tt_prefetch_ahead);
+    engine->get_options()["TTFront"] = config.tt_front ? std::string("true") : std::string("false");
+    engine->get_options()["CompactHistory"] = config.compact_history ? std::string("true") : std::string("false");
+    engine->get_options()["SharedHistory"] = config.shared_history ? std::string("true") : std::string("false");
+    engine->get_options()["SyzygyPath"] = config.syzygy_path;
+    engine->get_options()["SyzygyWarmup"] = config.syzygy_warmup ? std::string("true") : std::string("false");
+    engine->get_options()["SyzygyPin"] = config.syzygy_pin ? std::string("true") : std::string("false");
+    engine->get_options()["SyzygyProbeCache"] = config.syzygy_probe_cache ? std::string("true") : std::string("false");
+    engine->get_options()["TimeModel"] = config.time_model;
     
-    std::cout << "Engine configuration:\n"
-              << "  Skill Level: " << config.skill_level << "\n"
-              << "  Limit Strength: " << (config.limit_strength ? "true" : "false") << "\n"
-              << "  ELO: " << config.elo << "\n"
-              << "  Hash: " << config.hash << " MB\n"
-              << "  Ponder: " << (config.ponder ? "true" : "false") << "\n"
-              << "  MultiPV: " << config.multi_pv << "\n"
-              << "  Threads: " << config.threads << std::endl;
+    async_log(Info) << "Engine configuration:\n"
+                    << "  Skill Level: " << config.skill_level << "\n"
+                    << "  Limit Strength: " << (config.limit_strength ? "true" : "false") << "\n"
+                    << "  ELO: " << config.elo << "\n"
+                    << "  Skill Rescore: " << (config.skill_rescore ? "true" : "false") << "\n"
+                    << "  Hash: " << config.hash << " MB\n"
+                    << "  Ponder: " << (config.ponder ? "true" : "false") << "\n"
+                    << "  MultiPV: " << config.multi_pv << "\n"
+                    << "  Threads: " << config.threads << "\n"
+                    << "  Thread Placement: " << config.thread_placement
+                    << (config.exclusive_cores ? " (exclusive cores in " + config.core_lock_dir + ")" : "")
+                    << ", "
+                    << config.reserved_cores << " reserved cores\n"
+                    << "  Eval Cache: " << (config.eval_cache ? "true" : "false") << "\n"
+                    << "  Vector Move Picker: " << (config.vector_move_picker ? "true" : "false") << "\n"
+                    << "  TT Prefetch Ahead: " << config.tt_prefetch_ahead << "\n"
+                    << "  TT Front: " << (config.tt_front ? "true" : "false") << "\n"
+                    << "  Compact History: " << (config.compact_history ? "true" : "false") << "\n"
+                    << "  Shared History: " << (config.shared_history ? "true" : "false") << "\n"
+                    << "  Syzygy Path: " << (config.syzygy_path.empty() ? "<none>" : config.syzygy_path) << "\n"
+                    << "  Syzygy Warmup: " << (config.syzygy_warmup ? "true" : "false")
+                    << (config.syzygy_pin ? " (pinned)" : "") << "\n"
+                    << "  Syzygy Probe Cache: " << (config.syzygy_probe_cache ? "true" : "false") << "\n"
+                    << "  Time Model: " << (config.time_model.empty() ? "<formulas>" : config.time_model) << "\n"
+                    << "  Deadline Watchdog: "
+                    << (config.deadline_watchdog
+                          ? std::to_string(config.deadline_margin_ms) + " ms before the flag"
+                          : std::string("false"));
+    async_log(Info) << engine->memory_footprint_as_string();
 
     // Set callbacks
     engine->set_on_bestmove([this](std::string_view bestmove, std::string_view ponder) {
@@ -58,11 +95,24 @@ GrpcAgent::GrpcAgent(const AgentConfig& cfg) : config(cfg) {
     engine->set_on_update_full([](const Engine::InfoFull&) {});
     engine->set_on_iter([](const Engine::InfoIter&) {});
     engine->set_on_verify_networks([](std::string_view msg) { 
-        std::cout << "Network verify: " << msg << std::endl; 
+        async_log(Info) << "Network verify: " << msg; 
     });
+
+    if (config.deadline_watchdog) {
+        watchdog_thread = std::thread([this]() { watchdog_loop(); });
+    }
 }
 
 GrpcAgent::~GrpcAgent() {
+    if (watchdog_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(watchdog_mutex);
+            watchdog_exit = true;
+        }
+        watchdog_cv.notify_one();
+        watchdog_thread.join();
+    }
+
     if (engine) {
         engine->stop();
     }
@@ -71,10 +121,10 @@ GrpcAgent::~GrpcAgent() {
 void GrpcAgent::start() {
     // Loop for reconnection
     while (true) {
-        std::cout << "\n[CONNECTION] Connecting to server:\n"
-                  << "  server: " << config.server << ":" << config.server_port << "\n"
-                  << "  agent_group: " << (config.agent_group.empty() ? "[not set]" : config.agent_group) << "\n"
-                  << "  use_tls: " << (config.use_tls ? "true" : "false") << std::endl;
+        async_log(Info) << "\n[CONNECTION] Connecting to server:\n"
+                        << "  server: " << config.server << ":" << config.server_port << "\n"
+                        << "  agent_group: " << (config.agent_group.empty() ? "[not set]" : config.agent_group) << "\n"
+                        << "  use_tls: " << (config.use_tls ? "true" : "false");
         
         grpc::ClientContext context;
         stream = stub->PlayGame(&context);
@@ -102,15 +152,15 @@ void GrpcAgent::start() {
             join->set_specific_opponent_agent_id(config.specific_opponent_agent_id);
         }
         
-        std::cout << "\n[AGENT SEND] JoinRequest:\n"
-                  << "  api_key: " << (config.api_key.empty() ? "[not set]" : "[set]") << "\n"
-                  << "  agent_name: " << config.agent_name << "\n"
-                  << "  agent_group: " << (config.agent_group.empty() ? "[not set]" : config.agent_group) << "\n"
-                  << "  game_mode: " << config.game_mode << "\n"
-                  << "  time_control: " << config.time_control << "\n"
-                  << "  game_id: " << (config.target_game_id.empty() ? "[not set]" : config.target_game_id) << "\n"
-                  << "  wait_for_challenge: " << (!config.target_game_id.empty() ? "false (forced)" : (config.wait_for_challenge ? "true" : "false")) << "\n"
-                  << "  specific_opponent_agent_id: " << (config.specific_opponent_agent_id.empty() ? "[not set]" : config.specific_opponent_agent_id) << std::endl;
+        async_log(Info) << "\n[AGENT SEND] JoinRequest:\n"
+                        << "  api_key: " << (config.api_key.empty() ? "[not set]" : "[set]") << "\n"
+                        << "  agent_name: " << config.agent_name << "\n"
+                        << "  agent_group: " << (config.agent_group.empty() ? "[not set]" : config.agent_group) << "\n"
+                        << "  game_mode: " << config.game_mode << "\n"
+                        << "  time_control: " << config.time_control << "\n"
+                        << "  game_id: " << (config.target_game_id.empty() ? "[not set]" : config.target_game_id) << "\n"
+                        << "  wait_for_challenge: " << (!config.target_game_id.empty() ? "false (forced)" : (config.wait_for_challenge ? "true" : "false")) << "\n"
+                        << "  specific_opponent_agent_id: " << (config.specific_opponent_agent_id.empty() ? "[not set]" : config.specific_opponent_agent_id);
         
         bool success = false;
         {
@@ -122,20 +172,20 @@ void GrpcAgent::start() {
 
         if (!success) {
         } else {
-            std::cout << "Joined. Waiting for server messages..." << std::endl;
+            async_log(Info) << "Joined. Waiting for server messages...";
             should_exit_stream = false;
             run_stream();
 
             grpc::Status status = stream->Finish();
             if (!status.ok()) {
-                std::cout << "RPC failed: " << status.error_code() << ": " << status.error_message() << std::endl;
+                async_log(Warning) << "RPC failed: " << status.error_code() << ": " << status.error_message();
             } else {
-                std::cout << "RPC finished cleanly." << std::endl;
+                async_log(Info) << "RPC finished cleanly.";
             }
         }
 
         // If run_stream returns, stream is closed.
-        std::cout << "Disconnected. Retrying in 5 seconds..." << std::endl;
+        async_log(Info) << "Disconnected. Retrying in 5 seconds...";
         std::this_thread::sleep_for(std::chrono::seconds(5));
 
         // Reset stream
@@ -177,17 +227,17 @@ void GrpcAgent::handle_server_message(const chess_contest::ServerToClientMessage
 }
 
 void GrpcAgent::handle_game_started(const chess_contest::GameStarted& msg) {
-    std::cout << "\n[AGENT RECV] GameStarted:\n"
-              << "  game_id: " << msg.game_id() << "\n"
-              << "  color: " << msg.color() << "\n"
-              << "  initial_time_ms: " << msg.initial_time_ms() << "\n"
-              << "  increment_ms: " << msg.increment_ms() << "\n"
-              << "  opponent_name: " << msg.opponent_name() << std::endl;
+    async_log(Info) << "\n[AGENT RECV] GameStarted:\n"
+                    << "  game_id: " << msg.game_id() << "\n"
+                    << "  color: " << msg.color() << "\n"
+                    << "  initial_time_ms: " << msg.initial_time_ms() << "\n"
+                    << "  increment_ms: " << msg.increment_ms() << "\n"
+                    << "  opponent_name: " << msg.opponent_name();
 
     // Stop and clear engine outside the lock to avoid deadlock
-    std::cout << "Stopping engine..." << std::endl;
+    async_log(Debug) << "Stopping engine...";
     engine->stop();
-    std::cout << "Clearing search..." << std::endl;
+    async_log(Debug) << "Clearing search...";
     engine->search_clear();
 
     {
@@ -201,31 +251,36 @@ void GrpcAgent::handle_game_started(const chess_contest::GameStarted& msg) {
         is_searching_main = false;
     }
 
-    std::cout << "Setting position..." << std::endl;
+    async_log(Debug) << "Setting position...";
     engine->set_position(StartFEN, {});
     
     // Preheat engine: warm up neural networks and search structures
-    std::cout << "Preheating engine..." << std::endl;
+    async_log(Debug) << "Preheating engine...";
     Search::LimitsType preheat_limits;
     preheat_limits.depth = 6;  // Quick shallow search to initialize caches
     preheat_limits.startTime = now();
     engine->go(preheat_limits);
     engine->wait_for_search_finished();
-    std::cout << "Engine preheated and ready." << std::endl;
+    async_log(Info) << "Engine preheated and ready.";
     
-    std::cout << "Game setup complete." << std::endl;
+    async_log(Info) << "Game setup complete.";
 }
 
 void GrpcAgent::handle_move_request(const chess_contest::MoveRequest& msg) {
+    // The server clock runs from the request, the deadline of the watchdog too
+    TimePoint received = now();
+    disarm_watchdog();
+
     std::string opp_move = msg.opponent_move_lan();
-    std::cout << "\n[AGENT RECV] MoveRequest:\n"
-              << "  opponent_move_lan: " << (opp_move.empty() ? "[none - first move]" : opp_move) << "\n"
-              << "  your_remaining_time_ms: " << msg.your_remaining_time_ms() << "\n"
-              << "  opponent_remaining_time_ms: " << msg.opponent_remaining_time_ms() << std::endl;
+    async_log(Info) << "\n[AGENT RECV] MoveRequest:\n"
+                    << "  opponent_move_lan: " << (opp_move.empty() ? "[none - first move]" : opp_move) << "\n"
+                    << "  your_remaining_time_ms: " << msg.your_remaining_time_ms() << "\n"
+                    << "  opponent_remaining_time_ms: " << msg.opponent_remaining_time_ms();
 
     std::string game_id;
     std::string color;
     int inc_ms;
+    uint64_t search;
 
     {
         std::unique_lock<std::mutex> lock(agent_mutex);
@@ -240,6 +295,14 @@ void GrpcAgent::handle_move_request(const chess_contest::MoveRequest& msg) {
             is_pondering = false;
         }
 
+        // The watchdog moved without waiting for the previous search
+        if (search_overrun) {
+            lock.unlock();
+            engine->wait_for_search_finished();
+            lock.lock();
+            search_overrun = false;
+        }
+
         if (!opp_move.empty()) {
             game_moves.push_back(opp_move);
         }
@@ -250,6 +313,7 @@ void GrpcAgent::handle_move_request(const chess_contest::MoveRequest& msg) {
         // We set this here to allow on_bestmove to proceed when it fires
         active_search_game_id = current_game_id;
         is_searching_main = true;
+        search = ++search_id;
 
         // Update position safely inside lock
         // This ensures 'states' is recreated and valid for the next search
@@ -282,10 +346,10 @@ void GrpcAgent::handle_move_request(const chess_contest::MoveRequest& msg) {
         defensive_time = std::max<int64_t>(10, actual_time_ms - 50); // Last resort panic time
     }
 
-    std::cout << "Time Management: Server=" << actual_time_ms 
-              << "ms, Defensive=" << defensive_time 
-              << "ms (Margin=" << config.time_safety_margin_ms 
-              << ", Mult=" << config.time_usage_multiplier << ")" << std::endl;
+    async_log(Info) << "Time Management: Server=" << actual_time_ms 
+                    << "ms, Defensive=" << defensive_time 
+                    << "ms (Margin=" << config.time_safety_margin_ms 
+                    << ", Mult=" << config.time_usage_multiplier << ")";
 
     // 5. Pass the defensive time to the engine
     limits.time[us] = defensive_time;
@@ -296,11 +360,17 @@ void GrpcAgent::handle_move_request(const chess_contest::MoveRequest& msg) {
     limits.startTime = now();
 
     engine->go(limits);
+
+    // Armed once the search has published its first root move
+    if (config.deadline_watchdog) {
+        arm_watchdog(received + actual_time_ms - config.deadline_margin_ms, search);
+    }
 }
 
 void GrpcAgent::on_bestmove(std::string_view bestmove, std::string_view ponder) {
     std::string move_str(bestmove);
     std::string ponder_str(ponder);
+    std::string game_id;
 
     {
         std::lock_guard<std::mutex> lock(agent_mutex);
@@ -318,37 +388,119 @@ void GrpcAgent::on_bestmove(std::string_view bestmove, std::string_view ponder)
         }
 
         game_moves.push_back(move_str);
+        game_id = current_game_id;
 
         // Apply our move to the engine state incrementally
         // Use set_position to ensure states is recreated (it was moved to threads during search)
         engine->set_position(StartFEN, game_moves);
     }
 
+    disarm_watchdog();
+    send_move_response(game_id, move_str);
+
+    async_log(Info) << "Bestmove: " << move_str << " Ponder: " << ponder_str;
+
+    // The first 2^20 clusters, 32 MB of the table, are a fair sample and quick to count
+    if (config.tt_stats) {
+        async_log(Info) << engine->tt_stats_as_string(1 << 20);
+    }
+
+    if (!ponder_str.empty() && !should_exit_stream) {
+        std::thread([this, ponder_str]() {
+            this->start_ponder(ponder_str);
+        }).detach();
+    }
+}
+
+void GrpcAgent::send_move_response(const std::string& game_id, const std::string& move) {
     chess_contest::ClientToServerMessage req;
     auto resp = req.mutable_move_response();
-    resp->set_game_id(current_game_id);
-    resp->set_move_lan(move_str);
+    resp->set_game_id(game_id);
+    resp->set_move_lan(move);
+
+    async_log(Info) << "\n[AGENT SEND] MoveResponse:\n"
+                    << "  game_id: " << game_id << "\n"
+                    << "  move_lan: " << move;
 
-    std::cout << "\n[AGENT SEND] MoveResponse:\n"
-              << "  game_id: " << current_game_id << "\n"
-              << "  move_lan: " << move_str << std::endl;
+    std::lock_guard<std::mutex> stream_lock(stream_mutex);
+    if (stream) {
+        if (!stream->Write(req)) {
+            async_log(Error) << "Failed to send MoveResponse.";
+        }
+    }
+}
 
+void GrpcAgent::arm_watchdog(TimePoint deadline, uint64_t search) {
     {
-        std::lock_guard<std::mutex> stream_lock(stream_mutex);
-        if (stream) {
-            if (!stream->Write(req)) {
-                std::cerr << "Failed to send MoveResponse." << std::endl;
-            }
+        std::lock_guard<std::mutex> lock(watchdog_mutex);
+        watchdog_deadline = std::make_pair(deadline, search);
+    }
+    watchdog_armed++;
+    watchdog_cv.notify_one();
+}
+
+void GrpcAgent::disarm_watchdog() {
+    std::lock_guard<std::mutex> lock(watchdog_mutex);
+    watchdog_deadline.reset();
+}
+
+void GrpcAgent::watchdog_loop() {
+    std::unique_lock<std::mutex> lock(watchdog_mutex);
+
+    while (!watchdog_exit) {
+        if (!watchdog_deadline) {
+            watchdog_cv.wait(lock);
+            continue;
+        }
+
+        TimePoint remaining = watchdog_deadline->first - now();
+        if (remaining > 0) {
+            watchdog_cv.wait_for(lock, std::chrono::milliseconds(remaining));
+            continue;
         }
+
+        uint64_t search = watchdog_deadline->second;
+        watchdog_deadline.reset();
+
+        lock.unlock();
+        fire_watchdog(search);
+        lock.lock();
     }
+}
 
-    std::cout << "Bestmove: " << move_str << " Ponder: " << ponder_str << std::endl;
+// Plays the best move so far of a search that did not return in time, e.g. stalled
+// on tablebase page faults, swapping or a descheduled main thread. The search is
+// told to stop, and its bestmove ignored when it eventually comes.
+void GrpcAgent::fire_watchdog(uint64_t search) {
+    std::string game_id;
+    std::string move;
 
-    if (!ponder_str.empty() && !should_exit_stream) {
-        std::thread([this, ponder_str]() {
-            this->start_ponder(ponder_str);
-        }).detach();
+    {
+        std::lock_guard<std::mutex> lock(agent_mutex);
+
+        // The bestmove came first, or this is the deadline of an earlier search
+        if (!is_searching_main || search != search_id
+            || active_search_game_id != current_game_id || current_game_id.empty()) {
+            return;
+        }
+
+        move = engine->get_best_move_so_far().first;
+        if (move.empty()) {
+            return;
+        }
+
+        is_searching_main = false;
+        search_overrun = true;
+        game_moves.push_back(move);
+        game_id = current_game_id;
     }
+
+    engine->stop();
+    watchdog_fired++;
+
+    async_log(Warning) << "Deadline watchdog: no bestmove " << config.deadline_margin_ms
+                       << " ms before the flag, playing " << move;
+    send_move_response(game_id, move);
 }
 
 void GrpcAgent::start_ponder(std::string ponder_move) {
@@ -361,7 +513,7 @@ void GrpcAgent::start_ponder(std::string ponder_move) {
     if (active_search_game_id != current_game_id || current_game_id.empty()) return;
     if (is_pondering) return;
 
-    std::cout << "Starting ponder on: " << ponder_move << std::endl;
+    async_log(Info) << "Starting ponder on: " << ponder_move;
 
     is_pondering = true;
     predicted_ponder_move = ponder_move;
@@ -379,8 +531,8 @@ void GrpcAgent::start_ponder(std::string ponder_move) {
 }
 
 void GrpcAgent::handle_draw_offer(const chess_contest::DrawOfferEvent& msg) {
-    std::cout << "\n[AGENT RECV] DrawOfferEvent:\n"
-              << "  game_id: " << msg.game_id() << std::endl;
+    async_log(Info) << "\n[AGENT RECV] DrawOfferEvent:\n"
+                    << "  game_id: " << msg.game_id();
     
     if (config.auto_accept_draw) {
         chess_contest::ClientToServerMessage req;
@@ -388,9 +540,9 @@ void GrpcAgent::handle_draw_offer(const chess_contest::DrawOfferEvent& msg) {
         resp->set_game_id(msg.game_id());
         resp->set_accepted(true);
 
-        std::cout << "\n[AGENT SEND] DrawOfferResponse:\n"
-                  << "  game_id: " << msg.game_id() << "\n"
-                  << "  accepted: true" << std::endl;
+        async_log(Info) << "\n[AGENT SEND] DrawOfferResponse:\n"
+                        << "  game_id: " << msg.game_id() << "\n"
+                        << "  accepted: true";
 
         std::lock_guard<std::mutex> lock(stream_mutex);
         if (stream) stream->Write(req);
@@ -398,12 +550,18 @@ void GrpcAgent::handle_draw_offer(const chess_contest::DrawOfferEvent& msg) {
 }
 
 void GrpcAgent::handle_game_over(const chess_contest::GameOver& msg) {
-    std::cout << "\n[AGENT RECV] GameOver:\n"
-              << "  result: " << msg.result() << "\n"
-              << "  reason: " << msg.reason() << "\n"
-              << "  final_pgn: " << msg.final_pgn() << std::endl;
+    async_log(Info) << "\n[AGENT RECV] GameOver:\n"
+                    << "  result: " << msg.result() << "\n"
+                    << "  reason: " << msg.reason() << "\n"
+                    << "  final_pgn: " << msg.final_pgn();
+
+    if (config.deadline_watchdog) {
+        async_log(Info) << "Deadline watchdog: fired on " << watchdog_fired << " of "
+                        << watchdog_armed << " moves so far";
+    }
 
     // Stop engine outside lock to prevent deadlocks with on_bestmove
+    disarm_watchdog();
     engine->stop();
 
     {
@@ -426,8 +584,8 @@ void GrpcAgent::handle_game_over(const chess_contest::GameOver& msg) {
 }
 
 void GrpcAgent::handle_error(const chess_contest::Error& msg) {
-    std::cout << "\n[AGENT RECV] Error:\n"
-              << "  message: " << msg.message() << std::endl;
+    async_log(Info) << "\n[AGENT RECV] Error:\n"
+                    << "  message: " << msg.message();
 }
 
 } // namespace Stockfish
@@ -8,6 +8,9 @@
 #include <thread>
 #include <condition_variable>
 #include <optional>
+#include <atomic>
+#include <cstdint>
+#include <utility>
 
 #include <grpcpp/grpcpp.h>
 #include "chess_contest.grpc.pb.h"
@@ -35,6 +38,14 @@ private:
 
     void on_bestmove(std::string_view bestmove, std::string_view ponder);
     void start_ponder(std::string ponder_move);
+    void send_move_response(const std::string& game_id, const std::string& move);
+
+    // Deadline watchdog: plays the best move so far if the search has not
+    // returned shortly before our clock runs out
+    void arm_watchdog(TimePoint deadline, uint64_t search);
+    void disarm_watchdog();
+    void watchdog_loop();
+    void fire_watchdog(uint64_t search);
 
     AgentConfig config;
     std::shared_ptr<grpc::Channel> channel;
@@ -63,6 +74,20 @@ private:
     bool is_searching_main = false;
     std::string predicted_ponder_move;
 
+    // Counts the searches of our moves, the watchdog only moves for the current one
+    uint64_t search_id = 0;
+    // Set when the watchdog moved for a search that may still be running
+    bool search_overrun = false;
+
+    // Watchdog state, the deadline and the search it is armed for
+    std::thread watchdog_thread;
+    std::mutex watchdog_mutex;
+    std::condition_variable watchdog_cv;
+    std::optional<std::pair<TimePoint, uint64_t>> watchdog_deadline;
+    bool watchdog_exit = false;
+    std::atomic<uint64_t> watchdog_armed{0};
+    std::atomic<uint64_t> watchdog_fired{0};
+
     friend class PonderTest;
 };
 
@@ -28,24 +28,30 @@
 #include <limits>
 #include <type_traits>  // IWYU pragma: keep
 
+#include "memory.h"
 #include "misc.h"
 #include "position.h"
 
 namespace Stockfish {
 
-constexpr int PAWN_HISTORY_SIZE        = 8192;  // has to be a power of 2
-constexpr int UINT_16_HISTORY_SIZE     = std::numeric_limits<uint16_t>::max() + 1;
-constexpr int CORRECTION_HISTORY_LIMIT = 1024;
-constexpr int LOW_PLY_HISTORY_SIZE     = 5;
+constexpr int PAWN_HISTORY_SIZE         = 8192;  // has to be a power of 2
+constexpr int COMPACT_PAWN_HISTORY_SIZE = 1024;  // with the CompactHistory option
+constexpr int UINT_16_HISTORY_SIZE      = std::numeric_limits<uint16_t>::max() + 1;
+constexpr int CORRECTION_HISTORY_LIMIT  = 1024;
+constexpr int LOW_PLY_HISTORY_SIZE      = 5;
 
 static_assert((PAWN_HISTORY_SIZE & (PAWN_HISTORY_SIZE - 1)) == 0,
               "PAWN_HISTORY_SIZE has to be a power of 2");
 
+static_assert((COMPACT_PAWN_HISTORY_SIZE & (COMPACT_PAWN_HISTORY_SIZE - 1)) == 0,
+              "COMPACT_PAWN_HISTORY_SIZE has to be a power of 2");
+
 static_assert((UINT_16_HISTORY_SIZE & (UINT_16_HISTORY_SIZE - 1)) == 0,
               "CORRECTION_HISTORY_SIZE has to be a power of 2");
 
-inline int pawn_history_index(const Position& pos) {
-    return pos.pawn_key() & (PAWN_HISTORY_SIZE - 1);
+// Number of pawn history entries of the layout chosen by the CompactHistory option
+constexpr int pawn_history_size(bool compact) {
+    return compact ? COMPACT_PAWN_HISTORY_SIZE : PAWN_HISTORY_SIZE;
 }
 
 inline uint16_t pawn_correction_history_index(const Position& pos) { return pos.pawn_key(); }
@@ -115,8 +121,31 @@ using PieceToHistory = Stats<std::int16_t, 30000, PIECE_NB, SQUARE_NB>;
 // PieceToHistory instead of ButterflyBoards.
 using ContinuationHistory = MultiArray<PieceToHistory, PIECE_NB, SQUARE_NB>;
 
-// PawnHistory is addressed by the pawn structure and a move's [piece][to]
-using PawnHistory = Stats<std::int16_t, 8192, PAWN_HISTORY_SIZE, PIECE_NB, SQUARE_NB>;
+// PawnHistory is addressed by the pawn structure and a move's [piece][to]. The
+// number of pawn structure entries, a power of 2, is given at construction.
+class PawnHistory {
+   public:
+    using Entry = Stats<std::int16_t, 8192, PIECE_NB, SQUARE_NB>;
+
+    explicit PawnHistory(int size) :
+        entries(make_unique_large_page<Entry[]>(size)),
+        mask(size - 1) {
+        assert(size > 0 && (size & (size - 1)) == 0);
+    }
+
+    int index(const Position& pos) const { return pos.pawn_key() & mask; }
+    int size() const { return mask + 1; }
+
+    Entry&       operator[](int i) { return entries[i]; }
+    const Entry& operator[](int i) const { return entries[i]; }
+
+    Entry* begin() { return entries.get(); }
+    Entry* end() { return entries.get() + size(); }
+
+   private:
+    LargePagePtr<Entry[]> entries;
+    int                   mask;
+};
 
 // Correction histories record differences between the static evaluation of
 // positions and their search score. It is used to improve the static evaluation
@@ -160,6 +189,69 @@ using CorrectionHistory = typename Detail::CorrHistTypedef<T>::type;
 
 using TTMoveHistory = StatsEntry<std::int16_t, 8192>;
 
+// Histories that the threads of a NUMA node share with the SharedHistory option,
+// and that each thread owns otherwise. Shared tables are updated without any
+// synchronization, like the transposition table: a lost update only costs a bit
+// of move ordering or evaluation correction.
+struct SharedHistories {
+    // Left uninitialized, clear() writes the entries
+    explicit SharedHistories(int pawnHistorySize) :
+        pawnHistory(pawnHistorySize) {}
+
+    PawnHistory                pawnHistory;
+    CorrectionHistory<Pawn>    pawnCorrectionHistory;
+    CorrectionHistory<Minor>   minorPieceCorrectionHistory;
+    CorrectionHistory<NonPawn> nonPawnCorrectionHistory;
+
+    // Bytes allocated, with the pawn history entries allocated apart
+    std::size_t footprint() const {
+        return sizeof(*this) + pawnHistory.size() * sizeof(PawnHistory::Entry);
+    }
+
+    void clear() {
+        for (auto& entry : pawnHistory)
+            entry.fill(-1238);
+
+        pawnCorrectionHistory.fill(5);
+        minorPieceCorrectionHistory.fill(0);
+        nonPawnCorrectionHistory.fill(0);
+    }
+};
+
+// The shared histories of a NUMA node. The engine keeps them in a NumaReplicated,
+// which copies them from a thread of each node: a copy allocates and clears new
+// tables there, so that their memory is local to the node. Empty when disabled.
+class SharedHistoryTables {
+   public:
+    SharedHistoryTables() = default;
+    SharedHistoryTables(bool enabled, int pawnHistoryEntries) :
+        pawnHistorySize(pawnHistoryEntries) {
+        if (enabled)
+            allocate();
+    }
+
+    SharedHistoryTables(const SharedHistoryTables& other) :
+        pawnHistorySize(other.pawnHistorySize) {
+        if (other.tables)
+            allocate();
+    }
+
+    SharedHistoryTables(SharedHistoryTables&&)            = default;
+    SharedHistoryTables& operator=(SharedHistoryTables&&) = default;
+
+    // Writable by the search threads through the const NumaReplicated accessor
+    SharedHistories* get() const { return tables.get(); }
+
+   private:
+    void allocate() {
+        tables = make_unique_large_page<SharedHistories>(pawnHistorySize);
+        tables->clear();
+    }
+
+    LargePagePtr<SharedHistories> tables;
+    int                           pawnHistorySize = PAWN_HISTORY_SIZE;
+};
+
 }  // namespace Stockfish
 
 #endif  // #ifndef HISTORY_H_INCLUDED
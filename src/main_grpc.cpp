@@ -1,12 +1,17 @@
 #include <iostream>
 #include <memory>
+#include <optional>
+#include <string>
+#include <vector>
 
+#include "benchmark.h"
 #include "bitboard.h"
 #include "nnue/features/full_threats.h"
 #include "position.h"
 #include "misc.h"
 
 #include "agent_config.h"
+#include "analysis_service.h"
 #include "grpc_agent.h"
 #include "provisioner_agent.h"
 
@@ -19,15 +24,26 @@ int main(int argc, char* argv[]) {
     Position::init();
     Eval::NNUE::Features::init_threat_offsets();
 
+    // Offline benchmarks do not need an agent configuration
+    if (argc > 1 && std::string(argv[1]) == "--bench")
+        return Benchmark::run(argv[0], std::vector<std::string>(argv + 2, argv + argc));
+
     AgentConfig config = AgentConfig::load(argc, argv);
+    start_async_logger(config.log_level, config.log_format);
+
+    // Serves local analysis requests next to the games
+    std::optional<AnalysisService> analysis;
+    if (config.analysis_port > 0) {
+        analysis.emplace(config);
+    }
     
     // Check if running in provisioner mode
     if (config.provisioner_mode) {
-        std::cout << "Starting Provisioner Agent..." << std::endl;
+        async_log(Info) << "Starting Provisioner Agent...";
         ProvisionerAgent provisioner(config);
         provisioner.run(); // This blocks
     } else {
-        std::cout << "Starting gRPC agent..." << std::endl;
+        async_log(Info) << "Starting gRPC agent...";
         GrpcAgent agent(config);
         agent.start(); // This blocks
     }
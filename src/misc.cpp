@@ -23,6 +23,7 @@
 #include <cassert>
 #include <cctype>
 #include <cmath>
+#include <condition_variable>
 #include <cstdlib>
 #include <fstream>
 #include <iomanip>
@@ -32,6 +33,8 @@
 #include <mutex>
 #include <sstream>
 #include <string_view>
+#include <thread>
+#include <vector>
 
 #include "types.h"
 
@@ -316,6 +319,9 @@ std::array<DebugInfo<3>, MaxDebugSlots>  stdev;
 std::array<DebugInfo<6>, MaxDebugSlots>  correl;
 std::array<DebugExtremes, MaxDebugSlots> extremes;
 
+std::atomic<bool>     countAllocations;
+std::atomic<uint64_t> allocations;
+
 }  // namespace
 
 void dbg_hit_on(bool cond, int slot) {
@@ -409,6 +415,14 @@ void dbg_clear() {
     extremes.fill({});
 }
 
+void dbg_count_allocations(bool enable) {
+    if (enable)
+        allocations = 0;
+    countAllocations = enable;
+}
+
+uint64_t dbg_allocations() { return allocations; }
+
 // Used to serialize access to std::cout
 // to avoid multiple threads writing at the same time.
 std::ostream& operator<<(std::ostream& os, SyncCout sc) {
@@ -430,6 +444,274 @@ void sync_cout_end() { std::cout << IO_UNLOCK; }
 // Trampoline helper to avoid moving Logger to misc.h
 void start_logger(const std::string& fname) { Logger::start(fname); }
 
+namespace {
+
+std::atomic<LogLevel> logLevel = LogLevel::Info;
+
+struct LogEntry {
+    std::uint64_t sequence;
+    std::int64_t  time;  // Milliseconds since the epoch
+    std::size_t   thread;
+    LogLevel      level;
+    std::string   message;
+};
+
+// Ring buffer of the records of a single thread, read by the drain thread
+struct LogRing {
+    static constexpr std::size_t Size = 1024;
+
+    bool push(LogEntry& entry) {
+        std::size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == Size)
+            return false;
+
+        entries[h % Size] = std::move(entry);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    void pop_all(std::vector<LogEntry>& out) {
+        std::size_t t = tail.load(std::memory_order_relaxed);
+        std::size_t h = head.load(std::memory_order_acquire);
+
+        for (; t != h; ++t)
+            out.push_back(std::move(entries[t % Size]));
+
+        tail.store(t, std::memory_order_release);
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    std::array<LogEntry, Size> entries;
+    std::atomic<std::size_t>   head{0}, tail{0};
+    std::atomic<bool>          owned{true};
+    std::size_t                id;
+};
+
+void append_json_string(std::string& out, std::string_view s) {
+
+    static constexpr char Hex[] = "0123456789abcdef";
+
+    out += '"';
+    for (char c : s)
+        switch (c)
+        {
+        case '"' :
+            out += "\\\"";
+            break;
+        case '\\' :
+            out += "\\\\";
+            break;
+        case '\n' :
+            out += "\\n";
+            break;
+        case '\t' :
+            out += "\\t";
+            break;
+        default :
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                out += "\\u00";
+                out += Hex[(c >> 4) & 0xF];
+                out += Hex[c & 0xF];
+            }
+            else
+                out += c;
+        }
+    out += '"';
+}
+
+class AsyncLogger {
+   public:
+    static AsyncLogger& instance() {
+        static AsyncLogger l;
+        return l;
+    }
+
+    ~AsyncLogger() { stop(); }
+
+    void start(LogFormat f) {
+        stop();
+        format  = f;
+        drainer = std::thread([this] { drain_loop(); });
+        running = true;
+    }
+
+    void stop() {
+        if (!drainer.joinable())
+            return;
+
+        // Later records are written synchronously
+        running = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopRequested = true;
+        }
+        cv.notify_one();
+        drainer.join();
+        stopRequested = false;
+        drain();
+    }
+
+    // Returns false, and leaves the message alone, when not running
+    bool log(LogLevel level, std::string& message) {
+        if (!running.load(std::memory_order_relaxed))
+            return false;
+
+        static thread_local RingOwner owner;
+        if (!owner.ring)
+            owner.ring = acquire_ring();
+
+        LogEntry entry{sequence.fetch_add(1, std::memory_order_relaxed),
+                       std::chrono::duration_cast<std::chrono::milliseconds>(
+                         std::chrono::system_clock::now().time_since_epoch())
+                         .count(),
+                       owner.ring->id, level, std::move(message)};
+
+        if (!owner.ring->push(entry))
+            dropped.fetch_add(1, std::memory_order_relaxed);
+
+        return true;
+    }
+
+   private:
+    static constexpr auto DrainInterval = std::chrono::milliseconds(5);
+
+    // Gives the ring back when its thread exits, another thread reuses it once
+    // it has been drained.
+    struct RingOwner {
+        ~RingOwner() {
+            if (ring)
+                ring->owned = false;
+        }
+        LogRing* ring = nullptr;
+    };
+
+    LogRing* acquire_ring() {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+
+        for (auto& ring : rings)
+            if (!ring->owned && ring->empty())
+            {
+                ring->owned = true;
+                return ring.get();
+            }
+
+        rings.emplace_back(std::make_unique<LogRing>());
+        rings.back()->id = rings.size() - 1;
+        return rings.back().get();
+    }
+
+    void drain_loop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopRequested)
+        {
+            lock.unlock();
+            drain();
+            lock.lock();
+            cv.wait_for(lock, DrainInterval, [this] { return stopRequested; });
+        }
+    }
+
+    void drain() {
+        batch.clear();
+        {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            for (auto& ring : rings)
+                ring->pop_all(batch);
+        }
+
+        std::uint64_t lost = dropped.load(std::memory_order_relaxed);
+        if (batch.empty() && lost == reportedDropped)
+            return;
+
+        // The rings are drained in turn, restore the order of the records
+        std::sort(batch.begin(), batch.end(),
+                  [](const LogEntry& a, const LogEntry& b) { return a.sequence < b.sequence; });
+
+        static constexpr const char* LevelNames[] = {"debug", "info", "warning", "error"};
+
+        out.clear();
+        for (const LogEntry& e : batch)
+        {
+            if (format == LogFormat::Text)
+                out += e.message;
+            else
+            {
+                out += "{\"time\":" + std::to_string(e.time) + ",\"level\":\"";
+                out += LevelNames[int(e.level)];
+                out += "\",\"thread\":" + std::to_string(e.thread) + ",\"message\":";
+                append_json_string(out, e.message);
+                out += '}';
+            }
+            out += '\n';
+        }
+
+        if (lost != reportedDropped)
+        {
+            out += "Log buffer full, " + std::to_string(lost - reportedDropped)
+                 + " records dropped\n";
+            reportedDropped = lost;
+        }
+
+        std::cout << IO_LOCK << out << std::flush << IO_UNLOCK;
+    }
+
+    LogFormat                             format = LogFormat::Text;
+    std::atomic<bool>                     running{false};
+    std::atomic<std::uint64_t>            sequence{0}, dropped{0};
+    std::uint64_t                         reportedDropped = 0;
+    std::mutex                            ringsMutex;
+    std::vector<std::unique_ptr<LogRing>> rings;
+    std::vector<LogEntry>                 batch;
+    std::string                           out;
+    std::thread                           drainer;
+    std::mutex                            mutex;
+    std::condition_variable               cv;
+    bool                                  stopRequested = false;
+};
+
+}  // namespace
+
+void start_async_logger(LogLevel level, LogFormat format) {
+    logLevel = level;
+    AsyncLogger::instance().start(format);
+}
+
+void stop_async_logger() { AsyncLogger::instance().stop(); }
+
+bool log_enabled(LogLevel level) { return level >= logLevel.load(std::memory_order_relaxed); }
+
+std::optional<LogLevel> log_level_from_string(std::string_view name) {
+    if (name == "debug")
+        return LogLevel::Debug;
+    if (name == "info")
+        return LogLevel::Info;
+    if (name == "warning")
+        return LogLevel::Warning;
+    if (name == "error")
+        return LogLevel::Error;
+    if (name == "off")
+        return LogLevel::Off;
+    return std::nullopt;
+}
+
+std::optional<LogFormat> log_format_from_string(std::string_view name) {
+    if (name == "text")
+        return LogFormat::Text;
+    if (name == "json")
+        return LogFormat::Json;
+    return std::nullopt;
+}
+
+LogRecord::~LogRecord() {
+    std::string text = message.str();
+    if (!AsyncLogger::instance().log(level, text))
+        sync_cout << text << sync_endl;
+}
+
 
 #ifdef NO_PREFETCH
 
@@ -524,3 +806,24 @@ std::string CommandLine::get_working_directory() {
 
 
 }  // namespace Stockfish
+
+#ifdef USE_ALLOC_COUNT
+
+// Replaced to count the allocations for dbg_count_allocations(), including those
+// of the standard containers. Only in builds with allocs=yes.
+void* operator new(std::size_t size) {
+
+    if (Stockfish::countAllocations.load(std::memory_order_relaxed))
+        Stockfish::allocations.fetch_add(1, std::memory_order_relaxed);
+
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+
+    std::cerr << "Failed to allocate " << size << " bytes" << std::endl;
+    std::abort();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+#endif
@@ -32,6 +32,7 @@
 #include <optional>
 #include <cstring>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -79,6 +80,11 @@ void dbg_correl_of(int64_t value1, int64_t value2, int slot = 0);
 void dbg_print();
 void dbg_clear();
 
+// Counts the heap allocations of the whole process while enabled, enabling it
+// resets the count. Only counts in builds with allocs=yes, otherwise always 0.
+void          dbg_count_allocations(bool enable);
+std::uint64_t dbg_allocations();
+
 using TimePoint = std::chrono::milliseconds::rep;  // A value in milliseconds
 static_assert(sizeof(TimePoint) == sizeof(int64_t), "TimePoint should be 64 bits");
 inline TimePoint now() {
@@ -124,6 +130,58 @@ std::ostream& operator<<(std::ostream&, SyncCout);
 void sync_cout_start();
 void sync_cout_end();
 
+// Structured logging of the agent. A record is formatted on the calling thread
+// and pushed into a lock-free ring buffer owned by that thread. A background
+// thread started by start_async_logger() drains the rings, in the order of the
+// records, and writes them to std::cout through sync_cout with a single flush,
+// so that the caller never waits for the output. Records are dropped, and
+// counted, when the ring of a thread is full. Until the logger is started the
+// records are written synchronously.
+enum class LogLevel {
+    Debug,
+    Info,
+    Warning,
+    Error,
+    Off
+};
+
+enum class LogFormat {
+    Text,  // The message as is
+    Json   // One object per line: time in ms since the epoch, level, thread, message
+};
+
+void start_async_logger(LogLevel level, LogFormat format);
+void stop_async_logger();  // Writes the pending records
+bool log_enabled(LogLevel level);
+
+// Returns std::nullopt for an unknown name
+std::optional<LogLevel>  log_level_from_string(std::string_view name);
+std::optional<LogFormat> log_format_from_string(std::string_view name);
+
+// Collects the message of a record, which is logged when it is destroyed
+class LogRecord {
+   public:
+    explicit LogRecord(LogLevel l) :
+        level(l) {}
+    ~LogRecord();
+
+    template<typename T>
+    LogRecord& operator<<(const T& value) {
+        message << value;
+        return *this;
+    }
+
+   private:
+    LogLevel           level;
+    std::ostringstream message;
+};
+
+// async_log(Info) << ...; formats nothing when the level is disabled
+#define async_log(level) \
+    if (!Stockfish::log_enabled(Stockfish::LogLevel::level)) {} \
+    else \
+        Stockfish::LogRecord(Stockfish::LogLevel::level)
+
 // True if and only if the binary is compiled on a little-endian machine
 static inline const std::uint16_t Le             = 1;
 static inline const bool          IsLittleEndian = *reinterpret_cast<const char*>(&Le) == 1;
@@ -140,6 +198,8 @@ class ValueList {
     }
     const T* begin() const { return values_; }
     const T* end() const { return values_ + size_; }
+    T*       begin() { return values_; }
+    T*       end() { return values_ + size_; }
     const T& operator[](int index) const { return values_[index]; }
 
     T* make_space(size_t count) {
@@ -228,7 +228,7 @@ Move* generate_moves(const Position& pos, Move* moveList, Bitboard target) {
 template<Color Us, GenType Type>
 Move* generate_all(const Position& pos, Move* moveList) {
 
-    static_assert(Type != LEGAL, "Unsupported type in generate_all()");
+    static_assert(Type != LEGAL && Type != LEGAL_FILTERED, "Unsupported type in generate_all()");
 
     const Square ksq = pos.square<KING>(Us);
     Bitboard     target;
@@ -260,6 +260,157 @@ Move* generate_all(const Position& pos, Move* moveList) {
     return moveList;
 }
 
+
+// Generates the moves of the given pawns, all of them pinned along the same line
+// or none of them pinned, to the target squares. En passant captures are left to
+// the caller.
+template<Color Us>
+Move* generate_legal_pawn_moves(const Position& pos,
+                                Move*           moveList,
+                                Bitboard        pawns,
+                                Bitboard        target) {
+
+    constexpr Bitboard  TRank7BB = (Us == WHITE ? Rank7BB : Rank2BB);
+    constexpr Bitboard  TRank3BB = (Us == WHITE ? Rank3BB : Rank6BB);
+    constexpr Direction Up       = pawn_push(Us);
+    constexpr Direction UpRight  = (Us == WHITE ? NORTH_EAST : SOUTH_WEST);
+    constexpr Direction UpLeft   = (Us == WHITE ? NORTH_WEST : SOUTH_EAST);
+
+    const Bitboard emptySquares = ~pos.pieces();
+    const Bitboard enemies      = pos.pieces(~Us) & target;
+
+    Bitboard pawnsOn7    = pawns & TRank7BB;
+    Bitboard pawnsNotOn7 = pawns & ~TRank7BB;
+
+    // Single and double pawn pushes, no promotions
+    Bitboard b1 = shift<Up>(pawnsNotOn7) & emptySquares;
+    Bitboard b2 = shift<Up>(b1 & TRank3BB) & emptySquares & target;
+
+    moveList = splat_pawn_moves<Up>(moveList, b1 & target);
+    moveList = splat_pawn_moves<Up + Up>(moveList, b2);
+
+    // Promotions and underpromotions
+    if (pawnsOn7)
+    {
+        b1          = shift<UpRight>(pawnsOn7) & enemies;
+        b2          = shift<UpLeft>(pawnsOn7) & enemies;
+        Bitboard b3 = shift<Up>(pawnsOn7) & emptySquares & target;
+
+        while (b1)
+            moveList = make_promotions<NON_EVASIONS, UpRight, true>(moveList, pop_lsb(b1));
+
+        while (b2)
+            moveList = make_promotions<NON_EVASIONS, UpLeft, true>(moveList, pop_lsb(b2));
+
+        while (b3)
+            moveList = make_promotions<NON_EVASIONS, Up, false>(moveList, pop_lsb(b3));
+    }
+
+    // Standard captures
+    moveList = splat_pawn_moves<UpRight>(moveList, shift<UpRight>(pawnsNotOn7) & enemies);
+    moveList = splat_pawn_moves<UpLeft>(moveList, shift<UpLeft>(pawnsNotOn7) & enemies);
+
+    return moveList;
+}
+
+
+template<Color Us, PieceType Pt>
+Move* generate_legal_moves(const Position& pos, Move* moveList, Bitboard target) {
+
+    const Square ksq    = pos.square<KING>(Us);
+    Bitboard     pinned = pos.blockers_for_king(Us);
+    Bitboard     bb     = pos.pieces(Us, Pt) & (Pt == KNIGHT ? ~pinned : ~Bitboard(0));
+
+    while (bb)
+    {
+        Square   from = pop_lsb(bb);
+        Bitboard b    = attacks_bb<Pt>(from, pos.pieces()) & target;
+
+        // A pinned piece can only move along the line of the pin
+        if (pinned & from)
+            b &= line_bb(ksq, from);
+
+        moveList = splat_moves(moveList, from, b);
+    }
+
+    return moveList;
+}
+
+
+// Generates the legal moves directly, instead of filtering pseudo-legal ones. The
+// check and pin masks are computed once: when in check the other pieces can only
+// capture the checker or block the check, and a pinned piece can only move along
+// the line of the pin. Only en passant captures and castling, both rare, are
+// verified with Position::legal().
+template<Color Us>
+Move* generate_legal(const Position& pos, Move* moveList) {
+
+    const Square   ksq      = pos.square<KING>(Us);
+    const Bitboard checkers = pos.checkers();
+    const Bitboard pinned   = pos.blockers_for_king(Us) & pos.pieces(Us);
+
+    // Skip generating non-king moves when in double check
+    if (!more_than_one(checkers))
+    {
+        const Bitboard checkMask = checkers ? between_bb(ksq, lsb(checkers)) : ~Bitboard(0);
+        const Bitboard target    = ~pos.pieces(Us) & checkMask;
+
+        Bitboard pinnedPawns = pos.pieces(Us, PAWN) & pinned;
+
+        moveList =
+          generate_legal_pawn_moves<Us>(pos, moveList, pos.pieces(Us, PAWN) & ~pinned, target);
+
+        while (pinnedPawns)
+        {
+            Square from = pop_lsb(pinnedPawns);
+            moveList    = generate_legal_pawn_moves<Us>(pos, moveList, square_bb(from),
+                                                        target & line_bb(ksq, from));
+        }
+
+        // An en passant capture must capture the checking pawn or block a check,
+        // and it can uncover the king along the rank of the two pawns.
+        if (pos.ep_square() != SQ_NONE
+            && (checkMask & (square_bb(pos.ep_square()) | (pos.ep_square() - pawn_push(Us)))))
+        {
+            Bitboard b = pos.pieces(Us, PAWN) & attacks_bb<PAWN>(pos.ep_square(), ~Us);
+
+            while (b)
+            {
+                Move m = Move::make<EN_PASSANT>(pop_lsb(b), pos.ep_square());
+                if (pos.legal(m))
+                    *moveList++ = m;
+            }
+        }
+
+        moveList = generate_legal_moves<Us, KNIGHT>(pos, moveList, target);
+        moveList = generate_legal_moves<Us, BISHOP>(pos, moveList, target);
+        moveList = generate_legal_moves<Us, ROOK>(pos, moveList, target);
+        moveList = generate_legal_moves<Us, QUEEN>(pos, moveList, target);
+    }
+
+    // The king cannot move to an attacked square, including the squares behind
+    // it along the line of a slider checker.
+    Bitboard b = attacks_bb<KING>(ksq) & ~pos.pieces(Us);
+
+    while (b)
+    {
+        Square to = pop_lsb(b);
+        if (!pos.attackers_to_exist(to, pos.pieces() ^ ksq, ~Us))
+            *moveList++ = Move(ksq, to);
+    }
+
+    if (!checkers && pos.can_castle(Us & ANY_CASTLING))
+        for (CastlingRights cr : {Us & KING_SIDE, Us & QUEEN_SIDE})
+            if (!pos.castling_impeded(cr) && pos.can_castle(cr))
+            {
+                Move m = Move::make<CASTLING>(ksq, pos.castling_rook_square(cr));
+                if (pos.legal(m))
+                    *moveList++ = m;
+            }
+
+    return moveList;
+}
+
 }  // namespace
 
 
@@ -272,7 +423,7 @@ Move* generate_all(const Position& pos, Move* moveList) {
 template<GenType Type>
 Move* generate(const Position& pos, Move* moveList) {
 
-    static_assert(Type != LEGAL, "Unsupported type in generate()");
+    static_assert(Type != LEGAL && Type != LEGAL_FILTERED, "Unsupported type in generate()");
     assert((Type == EVASIONS) == bool(pos.checkers()));
 
     Color us = pos.side_to_move();
@@ -292,6 +443,17 @@ template Move* generate<NON_EVASIONS>(const Position&, Move*);
 template<>
 Move* generate<LEGAL>(const Position& pos, Move* moveList) {
 
+    return pos.side_to_move() == WHITE ? generate_legal<WHITE>(pos, moveList)
+                                       : generate_legal<BLACK>(pos, moveList);
+}
+
+// generate<LEGAL_FILTERED> generates the same moves as generate<LEGAL>, by filtering
+// the pseudo-legal moves with Position::legal(). It is the reference against which
+// generate<LEGAL> is verified.
+
+template<>
+Move* generate<LEGAL_FILTERED>(const Position& pos, Move* moveList) {
+
     Color    us     = pos.side_to_move();
     Bitboard pinned = pos.blockers_for_king(us) & pos.pieces(us);
     Square   ksq    = pos.square<KING>(us);
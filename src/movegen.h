@@ -33,7 +33,8 @@ enum GenType {
     QUIETS,
     EVASIONS,
     NON_EVASIONS,
-    LEGAL
+    LEGAL,
+    LEGAL_FILTERED
 };
 
 struct ExtMove: public Move {
@@ -18,18 +18,28 @@
 
 #include "movepick.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <limits>
 #include <utility>
 
 #include "bitboard.h"
 #include "misc.h"
 #include "position.h"
+#include "tt.h"
+
+#if defined(USE_AVX2)
+    #include <immintrin.h>
+#endif
 
 namespace Stockfish {
 
 namespace {
 
+// Number of moves picked one at a time after a partition, before sorting the rest
+constexpr int LazyPicks = 3;
+
 enum Stages {
     // generate main search moves
     MAIN_TT,
@@ -72,6 +82,63 @@ void partial_insertion_sort(ExtMove* begin, ExtMove* end, int limit) {
         }
 }
 
+// Moves the moves with a value of at least the given limit to the front, in their
+// current order, and returns the end of them. The other moves end up where
+// partial_insertion_sort() leaves them, and picking the front ones one at a time
+// with first_best() emits them in the order it sorts them.
+ExtMove* partition_moves(ExtMove* begin, ExtMove* end, int limit) {
+
+    if (begin == end)
+        return end;
+
+    ExtMove* sortedEnd = begin;
+    for (ExtMove* p = begin + 1; p < end; ++p)
+        if (p->value >= limit)
+            std::swap(*p, *++sortedEnd);
+
+    return sortedEnd + 1;
+}
+
+// Returns the first move with the highest value
+ExtMove* first_best(ExtMove* begin, ExtMove* end) {
+
+#if defined(USE_AVX2)
+    static_assert(sizeof(ExtMove) == 8, "Four moves per vector");
+
+    if (end - begin >= 8)
+    {
+        // The values of four moves, each one twice in place of the moves
+        auto values = [](const ExtMove* p) {
+            return _mm256_shuffle_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)),
+                                        0xF5);
+        };
+
+        __m256i best = values(end - 4);
+        for (const ExtMove* p = begin; p + 4 <= end; p += 4)
+            best = _mm256_max_epi32(best, values(p));
+
+        __m128i m = _mm_max_epi32(_mm256_castsi256_si128(best), _mm256_extracti128_si256(best, 1));
+        m         = _mm_max_epi32(m, _mm_shuffle_epi32(m, 0x4E));
+
+        // The last vector overlaps the previous one, which has no match then
+        const __m256i bestValue = _mm256_set1_epi32(_mm_cvtsi128_si32(m));
+        for (ExtMove* p = begin;; p = std::min(p + 4, end - 4))
+        {
+            __m256i equal = _mm256_cmpeq_epi32(values(p), bestValue);
+            if (auto mask = unsigned(_mm256_movemask_epi8(equal)))
+                return p + lsb(mask) / sizeof(ExtMove);
+        }
+    }
+#endif
+
+    ExtMove* best = begin;
+    for (ExtMove* p = begin + 1; p < end; ++p)
+        if (*best < *p)
+            best = p;
+
+    return best;
+}
+
 }  // namespace
 
 
@@ -88,14 +155,20 @@ MovePicker::MovePicker(const Position&              p,
                        const CapturePieceToHistory* cph,
                        const PieceToHistory**       ch,
                        const PawnHistory*           ph,
-                       int                          pl) :
+                       int                          pl,
+                       bool                         vec,
+                       const TranspositionTable*    tt_,
+                       int                          ahead) :
     pos(p),
     mainHistory(mh),
     lowPlyHistory(lph),
     captureHistory(cph),
     continuationHistory(ch),
     pawnHistory(ph),
+    tt(tt_),
+    prefetchAhead(ahead),
     ttMove(ttm),
+    vectorized(vec),
     depth(d),
     ply(pl) {
 
@@ -139,6 +212,9 @@ ExtMove* MovePicker::score(MoveList<Type>& ml) {
         threatByLesser[KING]  = pos.attacks_by<QUEEN>(~us) | threatByLesser[QUEEN];
     }
 
+    // Indices of the history entries of the quiets, for add_quiet_histories()
+    [[maybe_unused]] int pieceTo[MAX_MOVES], butterfly[MAX_MOVES];
+
     ExtMove* it = cur;
     for (auto move : ml)
     {
@@ -158,13 +234,22 @@ ExtMove* MovePicker::score(MoveList<Type>& ml) {
         else if constexpr (Type == QUIETS)
         {
             // histories
-            m.value = 2 * (*mainHistory)[us][m.raw()];
-            m.value += 2 * (*pawnHistory)[pawn_history_index(pos)][pc][to];
-            m.value += (*continuationHistory[0])[pc][to];
-            m.value += (*continuationHistory[1])[pc][to];
-            m.value += (*continuationHistory[2])[pc][to];
-            m.value += (*continuationHistory[3])[pc][to];
-            m.value += (*continuationHistory[5])[pc][to];
+            if (vectorized)
+            {
+                m.value                 = 0;
+                pieceTo[it - cur - 1]   = pc * SQUARE_NB + to;
+                butterfly[it - cur - 1] = m.raw();
+            }
+            else
+            {
+                m.value = 2 * (*mainHistory)[us][m.raw()];
+                m.value += 2 * (*pawnHistory)[pawnHistory->index(pos)][pc][to];
+                m.value += (*continuationHistory[0])[pc][to];
+                m.value += (*continuationHistory[1])[pc][to];
+                m.value += (*continuationHistory[2])[pc][to];
+                m.value += (*continuationHistory[3])[pc][to];
+                m.value += (*continuationHistory[5])[pc][to];
+            }
 
             // bonus for checks
             m.value += (bool(pos.check_squares(pt) & to) && pos.see_ge(m, -75)) * 16384;
@@ -191,21 +276,140 @@ ExtMove* MovePicker::score(MoveList<Type>& ml) {
             }
         }
     }
+
+    if constexpr (Type == QUIETS)
+        if (vectorized)
+            add_quiet_histories(cur, pieceTo, butterfly, int(it - cur));
+
     return it;
 }
 
+// Adds the history part of the quiet move scores of score<QUIETS>() to the given
+// moves, from the [piece][to] and the butterfly indices of each of them.
+void MovePicker::add_quiet_histories(ExtMove*   ms,
+                                     const int* pieceTo,
+                                     const int* butterfly,
+                                     int        count) const {
+
+    auto entries = [](const auto& history) {
+        return reinterpret_cast<const std::int16_t*>(&history[0]);
+    };
+
+    const std::int16_t* mainHist = entries((*mainHistory)[pos.side_to_move()]);
+    const std::int16_t* pawnHist = entries((*pawnHistory)[pawnHistory->index(pos)][0]);
+    const std::int16_t* contHist[] = {
+      entries((*continuationHistory[0])[0]), entries((*continuationHistory[1])[0]),
+      entries((*continuationHistory[2])[0]), entries((*continuationHistory[3])[0]),
+      entries((*continuationHistory[5])[0])};
+
+    int i = 0;
+
+#if defined(USE_AVX2)
+    // Gathers read 32 bits, the entry and the next one, which always exists as
+    // no index of a move is the last one of its table. Keep the low half.
+    auto gather = [](const std::int16_t* table, __m256i index) {
+        __m256i v = _mm256_i32gather_epi32(reinterpret_cast<const int*>(table), index, 2);
+        return _mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16);
+    };
+
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i pt = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pieceTo + i));
+        __m256i bf = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(butterfly + i));
+
+        __m256i sum = _mm256_add_epi32(gather(mainHist, bf), gather(pawnHist, pt));
+        sum         = _mm256_add_epi32(sum, sum);
+        for (const std::int16_t* table : contHist)
+            sum = _mm256_add_epi32(sum, gather(table, pt));
+
+        alignas(32) int values[8];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(values), sum);
+        for (int j = 0; j < 8; ++j)
+            ms[i + j].value += values[j];
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        int v = 2 * (mainHist[butterfly[i]] + pawnHist[pieceTo[i]]);
+        for (const std::int16_t* table : contHist)
+            v += table[pieceTo[i]];
+        ms[i].value += v;
+    }
+}
+
+// Orders the moves from cur to endCur in descending order, up to and including a
+// given limit, like partial_insertion_sort(). The vectorized path only moves them
+// to the front and leaves the rest to select(), so that they are not sorted when
+// a cutoff comes first.
+void MovePicker::sort(int limit) {
+
+    lazyPicks = 0;
+
+    if (vectorized)
+        endSorted = partition_moves(cur, endCur, limit);
+    else
+    {
+        partial_insertion_sort(cur, endCur, limit);
+        endSorted = cur;
+    }
+}
+
 // Returns the next move satisfying a predicate function.
 // This never returns the TT move, as it was emitted before.
 template<typename Pred>
 Move MovePicker::select(Pred filter) {
 
     for (; cur < endCur; ++cur)
+    {
+        // Bring the best of the moves left to sort to the front, keeping the order
+        // of the others so that ties are emitted in the same order as sorted. The
+        // first moves often cause a cutoff, past them sort the rest at once.
+        if (cur < endSorted)
+        {
+            if (++lazyPicks > LazyPicks)
+            {
+                partial_insertion_sort(cur, endSorted, std::numeric_limits<int>::min());
+                endSorted = cur;
+            }
+            else
+            {
+                ExtMove* best = first_best(cur, endSorted);
+                ExtMove  tmp  = *best;
+                std::move_backward(cur, best, best + 1);
+                *cur = tmp;
+            }
+        }
+
         if (*cur != ttMove && filter())
+        {
+            if (prefetchAhead && tt)
+                prefetch_ahead();
+
             return *cur++;
+        }
+    }
 
     return Move::none();
 }
 
+// Prefetches the TT entries of the positions after the moves following cur, up
+// to prefetchAhead of them, each one once. They are emitted next unless filtered
+// out, except among the moves still picked one at a time, which are skipped.
+void MovePicker::prefetch_ahead() {
+
+    if (cur + 1 < endSorted)
+        return;
+
+    // A new list of moves, or new moves of the same one after a stage change
+    if (prefetched <= cur || prefetched > endCur)
+        prefetched = cur + 1;
+
+    for (ExtMove* last = std::min(cur + 1 + prefetchAhead, endCur); prefetched < last;
+         ++prefetched)
+        prefetch(tt->first_entry(pos.key_after(*prefetched)));
+}
+
 // This is the most important method of the MovePicker class. We emit one
 // new pseudo-legal move on every call until there are no more moves left,
 // picking the move with the highest score from a list of generated moves.
@@ -231,7 +435,7 @@ top:
         cur = endBadCaptures = moves;
         endCur = endCaptures = score<CAPTURES>(ml);
 
-        partial_insertion_sort(cur, endCur, std::numeric_limits<int>::min());
+        sort(std::numeric_limits<int>::min());
         ++stage;
         goto top;
     }
@@ -255,7 +459,7 @@ top:
 
             endCur = endGenerated = score<QUIETS>(ml);
 
-            partial_insertion_sort(cur, endCur, -3560 * depth);
+            sort(-3560 * depth);
         }
 
         ++stage;
@@ -265,9 +469,9 @@ top:
         if (!skipQuiets && select([&]() { return cur->value > goodQuietThreshold; }))
             return *(cur - 1);
 
-        // Prepare the pointers to loop over the bad captures
-        cur    = moves;
-        endCur = endBadCaptures;
+        // Prepare the pointers to loop over the bad captures, already in order
+        cur = endSorted = moves;
+        endCur          = endBadCaptures;
 
         ++stage;
         [[fallthrough]];
@@ -276,9 +480,9 @@ top:
         if (select([]() { return true; }))
             return *(cur - 1);
 
-        // Prepare the pointers to loop over quiets again
-        cur    = endCaptures;
-        endCur = endGenerated;
+        // Prepare the pointers to loop over quiets again, already in order
+        cur = endSorted = endCaptures;
+        endCur          = endGenerated;
 
         ++stage;
         [[fallthrough]];
@@ -295,7 +499,7 @@ top:
         cur    = moves;
         endCur = endGenerated = score<EVASIONS>(ml);
 
-        partial_insertion_sort(cur, endCur, std::numeric_limits<int>::min());
+        sort(std::numeric_limits<int>::min());
         ++stage;
         [[fallthrough]];
     }
@@ -26,6 +26,7 @@
 namespace Stockfish {
 
 class Position;
+class TranspositionTable;
 
 // The MovePicker class is used to pick one pseudo-legal move at a time from the
 // current position. The most important method is next_move(), which emits one
@@ -46,7 +47,10 @@ class MovePicker {
                const CapturePieceToHistory*,
                const PieceToHistory**,
                const PawnHistory*,
-               int);
+               int,
+               bool                      = false,
+               const TranspositionTable* = nullptr,
+               int                       = 0);
     MovePicker(const Position&, Move, int, const CapturePieceToHistory*);
     Move next_move();
     void skip_quiet_moves();
@@ -56,6 +60,9 @@ class MovePicker {
     Move select(Pred);
     template<GenType T>
     ExtMove* score(MoveList<T>&);
+    void     add_quiet_histories(ExtMove*, const int*, const int*, int) const;
+    void     sort(int);
+    void     prefetch_ahead();
     ExtMove* begin() { return cur; }
     ExtMove* end() { return endCur; }
 
@@ -65,8 +72,21 @@ class MovePicker {
     const CapturePieceToHistory* captureHistory;
     const PieceToHistory**       continuationHistory;
     const PawnHistory*           pawnHistory;
+    const TranspositionTable*    tt = nullptr;
+    // Number of moves, 0 to 2, after the one being emitted whose TT entries are
+    // prefetched, so that they are in cache when the search reaches them instead
+    // of only from do_move(). Only with the TT. Set by the TTPrefetchAhead option.
+    int                          prefetchAhead = 0;
     Move                         ttMove;
+    // Sums the history scores of the quiet moves table by table, several moves at
+    // a time, and picks the first moves with a vectorized argmax instead of sorting
+    // them up front. The order of the moves is the same either way. Set by the
+    // VectorMovePicker option.
+    bool                         vectorized = false;
     ExtMove *                    cur, *endCur, *endBadCaptures, *endCaptures, *endGenerated;
+    ExtMove*                     endSorted;
+    ExtMove*                     prefetched = nullptr;
+    int                          lazyPicks;
     int                          stage;
     int                          threshold;
     Depth                        depth;
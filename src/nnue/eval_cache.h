@@ -0,0 +1,92 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Per-thread cache of network outputs
+
+#ifndef NNUE_EVAL_CACHE_H_INCLUDED
+#define NNUE_EVAL_CACHE_H_INCLUDED
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "../types.h"
+#include "network.h"
+#include "nnue_common.h"
+
+namespace Stockfish::Eval::NNUE {
+
+// EvalCache remembers the raw output of the big and the small network for
+// recently evaluated positions, so that positions reached again through
+// transpositions, qsearch revisits and re-searches skip the network. The output
+// only depends on the pieces and the side to move, so the position key is a
+// valid tag. Entries are direct-mapped and always replaced.
+class EvalCache {
+   public:
+    static constexpr std::size_t Size = 1 << 14;  // Entries per network
+
+    struct Stats {
+        std::uint64_t probes = 0, hits = 0;
+    };
+
+    bool probe(EmbeddedNNUEType net, Key key, NetworkOutput& output) {
+        const Entry& e = table(net)[key & (Size - 1)];
+
+        ++stats.probes;
+        if (e.key != key)
+            return false;
+
+        ++stats.hits;
+        output = {e.psqt, e.positional};
+        return true;
+    }
+
+    void store(EmbeddedNNUEType net, Key key, const NetworkOutput& output) {
+        Entry& e     = table(net)[key & (Size - 1)];
+        e.key        = key;
+        e.psqt       = std::get<0>(output);
+        e.positional = std::get<1>(output);
+    }
+
+    void clear() {
+        big.fill({});
+        small.fill({});
+        stats = {};
+    }
+
+    Stats stats;
+
+   private:
+    struct Entry {
+        Key          key;
+        std::int32_t psqt, positional;
+    };
+
+    static_assert(CacheLineSize % sizeof(Entry) == 0, "Entries must not span cache lines");
+
+    std::array<Entry, Size>& table(EmbeddedNNUEType net) {
+        return net == EmbeddedNNUEType::BIG ? big : small;
+    }
+
+    alignas(CacheLineSize) std::array<Entry, Size> big;
+    alignas(CacheLineSize) std::array<Entry, Size> small;
+};
+
+}  // namespace Stockfish::Eval::NNUE
+
+#endif  // #ifndef NNUE_EVAL_CACHE_H_INCLUDED
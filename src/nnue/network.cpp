@@ -18,6 +18,7 @@
 
 #include "network.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
@@ -108,7 +109,9 @@ bool write_parameters(std::ostream& stream, const T& reference) {
 }  // namespace Detail
 
 template<typename Arch, typename Transformer>
-void Network<Arch, Transformer>::load(const std::string& rootDirectory, std::string evalfilePath) {
+void Network<Arch, Transformer>::load(const std::string& rootDirectory,
+                                      std::string        evalfilePath,
+                                      const std::string& cacheDirectory) {
 #if defined(DEFAULT_NNUE_DIRECTORY)
     std::vector<std::string> dirs = {"<internal>", "", rootDirectory,
                                      stringify(DEFAULT_NNUE_DIRECTORY)};
@@ -125,12 +128,12 @@ void Network<Arch, Transformer>::load(const std::string& rootDirectory, std::str
         {
             if (directory != "<internal>")
             {
-                load_user_net(directory, evalfilePath);
+                load_user_net(directory, evalfilePath, cacheDirectory);
             }
 
             if (directory == "<internal>" && evalfilePath == std::string(evalFile.defaultName))
             {
-                load_internal();
+                load_internal(cacheDirectory);
             }
         }
     }
@@ -189,6 +192,73 @@ Network<Arch, Transformer>::evaluate(const Position&                         pos
 }
 
 
+template<typename Arch, typename Transformer>
+void Network<Arch, Transformer>::evaluate_batch(
+  const Position* const*                  positions,
+  std::size_t                             count,
+  AccumulatorStack&                       accumulatorStack,
+  AccumulatorCaches::Cache<FTDimensions>& cache,
+  NetworkOutput*                          outputs) const {
+
+    constexpr uint64_t  alignment  = CacheLineSize;
+    constexpr IndexType BufferSize = FeatureTransformer<FTDimensions>::BufferSize;
+
+    alignas(alignment) static thread_local TransformedFeatureType
+      transformedFeatures[EvalBatchSize][BufferSize];
+
+    ASSERT_ALIGNED(transformedFeatures, alignment);
+
+    for (std::size_t begin = 0; begin < count; begin += EvalBatchSize)
+    {
+        const std::size_t n = std::min<std::size_t>(count - begin, EvalBatchSize);
+
+        std::int32_t psqt[EvalBatchSize];
+        std::int32_t positional[EvalBatchSize];
+        int          buckets[EvalBatchSize];
+
+        // Positions are unrelated, so every accumulator is built from the
+        // refresh cache instead of being updated incrementally.
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            const Position& pos = *positions[begin + i];
+
+            accumulatorStack.reset();
+            buckets[i] = (pos.count<ALL_PIECES>() - 1) / 4;
+            psqt[i]    = featureTransformer.transform(pos, accumulatorStack, cache,
+                                                      transformedFeatures[i], buckets[i]);
+        }
+
+        // Group the positions by layer stack and propagate each group together
+        for (IndexType bucket = 0; bucket < LayerStacks; ++bucket)
+        {
+            const TransformedFeatureType* inputs[EvalBatchSize];
+            std::size_t                   indices[EvalBatchSize];
+            std::int32_t                  results[EvalBatchSize];
+            std::size_t                   size = 0;
+
+            for (std::size_t i = 0; i < n; ++i)
+                if (buckets[i] == int(bucket))
+                {
+                    inputs[size]    = transformedFeatures[i];
+                    indices[size++] = i;
+                }
+
+            if (!size)
+                continue;
+
+            network[bucket].propagate_batch(inputs, size, results);
+
+            for (std::size_t i = 0; i < size; ++i)
+                positional[indices[i]] = results[i];
+        }
+
+        for (std::size_t i = 0; i < n; ++i)
+            outputs[begin + i] = {static_cast<Value>(psqt[i] / OutputScale),
+                                  static_cast<Value>(positional[i] / OutputScale)};
+    }
+}
+
+
 template<typename Arch, typename Transformer>
 void Network<Arch, Transformer>::verify(std::string                                  evalfilePath,
                                         const std::function<void(std::string_view)>& f) const {
@@ -261,7 +331,14 @@ Network<Arch, Transformer>::trace_evaluate(const Position&
 
 template<typename Arch, typename Transformer>
 void Network<Arch, Transformer>::load_user_net(const std::string& dir,
-                                               const std::string& evalfilePath) {
+                                               const std::string& evalfilePath,
+                                               const std::string& cacheDirectory) {
+    const auto cacheEntry = NetworkCache::entry(
+      cacheDirectory, NetworkCache::file_source(dir + evalfilePath), hash, sizeof(Network));
+
+    if (load_cached(cacheEntry))
+        return;
+
     std::ifstream stream(dir + evalfilePath, std::ios::binary);
     auto          description = load(stream);
 
@@ -269,12 +346,13 @@ void Network<Arch, Transformer>::load_user_net(const std::string& dir,
     {
         evalFile.current        = evalfilePath;
         evalFile.netDescription = description.value();
+        save_cached(cacheEntry);
     }
 }
 
 
 template<typename Arch, typename Transformer>
-void Network<Arch, Transformer>::load_internal() {
+void Network<Arch, Transformer>::load_internal(const std::string& cacheDirectory) {
     // C++ way to prepare a buffer for a memory stream
     class MemoryBuffer: public std::basic_streambuf<char> {
        public:
@@ -286,6 +364,14 @@ void Network<Arch, Transformer>::load_internal() {
 
     const auto embedded = get_embedded(embeddedType);
 
+    const auto cacheEntry = NetworkCache::entry(
+      cacheDirectory,
+      NetworkCache::embedded_source(std::string(evalFile.defaultName), embedded.size), hash,
+      sizeof(Network));
+
+    if (load_cached(cacheEntry))
+        return;
+
     MemoryBuffer buffer(const_cast<char*>(reinterpret_cast<const char*>(embedded.data)),
                         size_t(embedded.size));
 
@@ -296,10 +382,31 @@ void Network<Arch, Transformer>::load_internal() {
     {
         evalFile.current        = evalFile.defaultName;
         evalFile.netDescription = description.value();
+        save_cached(cacheEntry);
     }
 }
 
 
+// Replaces this network with its preprocessed image from the cache. The image
+// carries the file name, description and content hash of the network.
+template<typename Arch, typename Transformer>
+bool Network<Arch, Transformer>::load_cached(const std::optional<NetworkCache::Entry>& entry) {
+    if (!entry)
+        return false;
+
+    // The image is only copied once its header matched the entry
+    return NetworkCache::load(*entry, this, sizeof(Network)).has_value();
+}
+
+
+template<typename Arch, typename Transformer>
+void Network<Arch, Transformer>::save_cached(
+  const std::optional<NetworkCache::Entry>& entry) const {
+    if (entry)
+        NetworkCache::save(*entry, this, sizeof(Network), get_content_hash());
+}
+
+
 template<typename Arch, typename Transformer>
 void Network<Arch, Transformer>::initialize() {
     initialized = true;
@@ -320,24 +427,30 @@ bool Network<Arch, Transformer>::save(std::ostream&      stream,
 template<typename Arch, typename Transformer>
 std::optional<std::string> Network<Arch, Transformer>::load(std::istream& stream) {
     initialize();
+    contentHash = 0;
     std::string description;
 
     return read_parameters(stream, description) ? std::make_optional(description) : std::nullopt;
 }
 
 
+// The hash covers all the parameters, so it is computed once per load and
+// stored with the network, including in the cache of preprocessed networks.
 template<typename Arch, typename Transformer>
 std::size_t Network<Arch, Transformer>::get_content_hash() const {
     if (!initialized)
         return 0;
 
+    if (contentHash)
+        return contentHash;
+
     std::size_t h = 0;
     hash_combine(h, featureTransformer);
     for (auto&& layerstack : network)
         hash_combine(h, layerstack);
     hash_combine(h, evalFile);
     hash_combine(h, static_cast<int>(embeddedType));
-    return h;
+    return contentHash = h;
 }
 
 // Read network header
@@ -37,6 +37,7 @@
 #include "nnue_common.h"
 #include "nnue_feature_transformer.h"
 #include "nnue_misc.h"
+#include "network_cache.h"
 
 namespace Stockfish {
 class Position;
@@ -69,7 +70,10 @@ class Network {
     Network& operator=(const Network& other) = default;
     Network& operator=(Network&& other)      = default;
 
-    void load(const std::string& rootDirectory, std::string evalfilePath);
+    // A non-empty cacheDirectory enables the cache of preprocessed networks
+    void load(const std::string& rootDirectory,
+              std::string        evalfilePath,
+              const std::string& cacheDirectory);
     bool save(const std::optional<std::string>& filename) const;
 
     std::size_t get_content_hash() const;
@@ -78,6 +82,13 @@ class Network {
                            AccumulatorStack&                       accumulatorStack,
                            AccumulatorCaches::Cache<FTDimensions>& cache) const;
 
+    // Evaluates `count` unrelated positions. The accumulators are refreshed for
+    // every position, and the layer stacks are propagated a batch at a time.
+    void evaluate_batch(const Position* const*                  positions,
+                        std::size_t                             count,
+                        AccumulatorStack&                       accumulatorStack,
+                        AccumulatorCaches::Cache<FTDimensions>& cache,
+                        NetworkOutput*                          outputs) const;
 
     void verify(std::string evalfilePath, const std::function<void(std::string_view)>&) const;
     NnueEvalTrace trace_evaluate(const Position&                         pos,
@@ -85,8 +96,11 @@ class Network {
                                  AccumulatorCaches::Cache<FTDimensions>& cache) const;
 
    private:
-    void load_user_net(const std::string&, const std::string&);
-    void load_internal();
+    void load_user_net(const std::string&, const std::string&, const std::string&);
+    void load_internal(const std::string&);
+
+    bool load_cached(const std::optional<NetworkCache::Entry>&);
+    void save_cached(const std::optional<NetworkCache::Entry>&) const;
 
     void initialize();
 
@@ -110,6 +124,9 @@ class Network {
 
     bool initialized = false;
 
+    // Cached result of get_content_hash(), zero until computed
+    mutable std::size_t contentHash = 0;
+
     // Hash value of evaluation function structure
     static constexpr std::uint32_t hash = Transformer::get_hash_value() ^ Arch::get_hash_value();
 
@@ -0,0 +1,197 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "network_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+
+#include "../misc.h"
+#include "../shm.h"
+
+#if !defined(_WIN32)
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace Stockfish::Eval::NNUE::NetworkCache {
+
+namespace {
+
+constexpr char Magic[8] = "SFNNUEC";
+
+struct Header {
+    char          magic[8];
+    std::uint64_t key;
+    std::uint64_t size;
+    std::uint64_t contentHash;
+};
+
+// The image starts on a page boundary so that the mapping of the network
+// keeps the alignment of its members.
+constexpr std::size_t ImageOffset = 4096;
+
+static_assert(sizeof(Header) <= ImageOffset);
+
+}  // namespace
+
+#if !defined(_WIN32)
+
+std::string file_source(const std::string& path) {
+    struct stat st;
+    if (path.empty() || stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+        return "";
+
+    return "file:" + path + ":" + std::to_string(st.st_size) + ":"
+         + std::to_string(st.st_mtime);
+}
+
+std::string embedded_source(const std::string& name, std::size_t size) {
+    return "embedded:" + name + ":" + std::to_string(size);
+}
+
+std::optional<Entry> entry(const std::string& cacheDirectory,
+                           const std::string& source,
+                           std::uint32_t      archHash,
+                           std::size_t        size) {
+    if (cacheDirectory.empty() || source.empty())
+        return std::nullopt;
+
+    // The layout of the image depends on the SIMD architecture and on the code
+    // of this particular build, so the executable itself is part of the key.
+    std::string id = source + "$" + std::to_string(archHash) + "$" + std::to_string(size) + "$"
+#if defined(ARCH)
+                   + stringify(ARCH) + "$"
+#endif
+                   + engine_version_info() + "$" + file_source(getExecutablePathHash());
+
+    std::uint64_t key = std::hash<std::string>{}(id);
+
+    std::stringstream ss;
+    ss << cacheDirectory << (cacheDirectory.back() == '/' ? "" : "/") << "nn-cache-" << std::hex
+       << std::setfill('0') << std::setw(16) << key << ".bin";
+
+    return Entry{ss.str(), key};
+}
+
+std::optional<std::size_t> load(const Entry& entry, void* dst, std::size_t size) {
+    int fd = open(entry.path.c_str(), O_RDONLY);
+    if (fd == -1)
+        return std::nullopt;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || std::size_t(st.st_size) != ImageOffset + size)
+    {
+        close(fd);
+        return std::nullopt;
+    }
+
+    void* mapped = mmap(nullptr, ImageOffset + size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (mapped == MAP_FAILED)
+        return std::nullopt;
+
+    #if defined(MADV_SEQUENTIAL)
+    madvise(mapped, ImageOffset + size, MADV_SEQUENTIAL);
+    #endif
+
+    Header header;
+    std::memcpy(&header, mapped, sizeof(header));
+
+    std::optional<std::size_t> contentHash;
+
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) == 0 && header.key == entry.key
+        && header.size == size)
+    {
+        std::memcpy(dst, static_cast<const char*>(mapped) + ImageOffset, size);
+        contentHash = std::size_t(header.contentHash);
+    }
+
+    munmap(mapped, ImageOffset + size);
+    return contentHash;
+}
+
+bool save(const Entry& entry, const void* src, std::size_t size, std::size_t contentHash) {
+    const std::string& path = entry.path;
+
+    // Create the cache directory if needed, the parent must exist
+    std::string dir = path.substr(0, path.rfind('/'));
+    if (!dir.empty() && mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+        return false;
+
+    // Write to a private file first and rename it, so that a concurrently
+    // starting process never maps a partially written image.
+    std::string tmp = path + ".tmp" + std::to_string(getpid());
+
+    int fd = open(tmp.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    if (fd == -1)
+        return false;
+
+    Header header{};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.key         = entry.key;
+    header.size        = size;
+    header.contentHash = contentHash;
+
+    char page[ImageOffset] = {};
+    std::memcpy(page, &header, sizeof(header));
+
+    auto write_all = [fd](const char* data, std::size_t n) {
+        while (n)
+        {
+            ssize_t written = write(fd, data, n);
+            if (written <= 0)
+                return false;
+            data += written;
+            n -= std::size_t(written);
+        }
+        return true;
+    };
+
+    bool ok = write_all(page, sizeof(page)) && write_all(static_cast<const char*>(src), size);
+    ok      = close(fd) == 0 && ok;
+
+    if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0)
+    {
+        std::remove(tmp.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+#else
+
+std::string file_source(const std::string&) { return ""; }
+std::string embedded_source(const std::string&, std::size_t) { return ""; }
+std::optional<Entry> entry(const std::string&, const std::string&, std::uint32_t, std::size_t) {
+    return std::nullopt;
+}
+std::optional<std::size_t> load(const Entry&, void*, std::size_t) { return std::nullopt; }
+bool save(const Entry&, const void*, std::size_t, std::size_t) { return false; }
+
+#endif
+
+}  // namespace Stockfish::Eval::NNUE::NetworkCache
@@ -0,0 +1,63 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Cache of preprocessed networks. A cache file holds the in-memory image of a
+// network after its parameters have been read, permuted and scaled for the
+// running build, so that later processes can map it instead of parsing the
+// .nnue file again.
+
+#ifndef NETWORK_CACHE_H_INCLUDED
+#define NETWORK_CACHE_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace Stockfish::Eval::NNUE::NetworkCache {
+
+// Identifies a network file on disk by path, size and modification time.
+// Returns an empty string if the file does not exist.
+std::string file_source(const std::string& path);
+
+// Identifies an embedded network by name and size
+std::string embedded_source(const std::string& name, std::size_t size);
+
+struct Entry {
+    std::string   path;
+    std::uint64_t key;
+};
+
+// Returns the cache entry of a network of `size` bytes and architecture hash
+// `archHash` loaded from `source` by this build, or std::nullopt if caching is
+// disabled or not supported on this platform.
+std::optional<Entry> entry(const std::string& cacheDirectory,
+                           const std::string& source,
+                           std::uint32_t      archHash,
+                           std::size_t        size);
+
+// Maps the cache file and copies the network image into `dst`. Returns the
+// content hash stored with the image, or std::nullopt on a miss.
+std::optional<std::size_t> load(const Entry& entry, void* dst, std::size_t size);
+
+// Atomically writes the network image to the cache file
+bool save(const Entry& entry, const void* src, std::size_t size, std::size_t contentHash);
+
+}  // namespace Stockfish::Eval::NNUE::NetworkCache
+
+#endif  // #ifndef NETWORK_CACHE_H_INCLUDED
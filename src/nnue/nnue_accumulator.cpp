@@ -18,6 +18,7 @@
 
 #include "nnue_accumulator.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <new>
@@ -40,24 +41,26 @@ using namespace SIMD;
 namespace {
 
 template<IndexType TransformedFeatureDimensions>
-void double_inc_update(Color                                                   perspective,
-                       const FeatureTransformer<TransformedFeatureDimensions>& featureTransformer,
-                       const Square                                            ksq,
-                       AccumulatorState<PSQFeatureSet>&                        middle_state,
-                       AccumulatorState<PSQFeatureSet>&                        target_state,
-                       const AccumulatorState<PSQFeatureSet>&                  computed);
+std::size_t
+double_inc_update(Color                                                   perspective,
+                  const FeatureTransformer<TransformedFeatureDimensions>& featureTransformer,
+                  const Square                                            ksq,
+                  AccumulatorState<PSQFeatureSet>&                        middle_state,
+                  AccumulatorState<PSQFeatureSet>&                        target_state,
+                  const AccumulatorState<PSQFeatureSet>&                  computed);
 
 template<IndexType TransformedFeatureDimensions>
-void double_inc_update(Color                                                   perspective,
-                       const FeatureTransformer<TransformedFeatureDimensions>& featureTransformer,
-                       const Square                                            ksq,
-                       AccumulatorState<ThreatFeatureSet>&                     middle_state,
-                       AccumulatorState<ThreatFeatureSet>&                     target_state,
-                       const AccumulatorState<ThreatFeatureSet>&               computed,
-                       const DirtyPiece&                                       dp2);
+std::size_t
+double_inc_update(Color                                                   perspective,
+                  const FeatureTransformer<TransformedFeatureDimensions>& featureTransformer,
+                  const Square                                            ksq,
+                  AccumulatorState<ThreatFeatureSet>&                     middle_state,
+                  AccumulatorState<ThreatFeatureSet>&                     target_state,
+                  const AccumulatorState<ThreatFeatureSet>&               computed,
+                  const DirtyPiece&                                       dp2);
 
 template<bool Forward, typename FeatureSet, IndexType TransformedFeatureDimensions>
-void update_accumulator_incremental(
+std::size_t update_accumulator_incremental(
   Color                                                   perspective,
   const FeatureTransformer<TransformedFeatureDimensions>& featureTransformer,
   const Square                                            ksq,
@@ -72,10 +75,12 @@ void update_accumulator_refresh_cache(Color                                 pers
                                       AccumulatorCaches::Cache<Dimensions>& cache);
 
 template<IndexType Dimensions>
-void update_threats_accumulator_full(Color                                 perspective,
-                                     const FeatureTransformer<Dimensions>& featureTransformer,
-                                     const Position&                       pos,
-                                     AccumulatorState<ThreatFeatureSet>&   accumulatorState);
+void update_threats_accumulator_refresh_cache(
+  Color                                 perspective,
+  const FeatureTransformer<Dimensions>& featureTransformer,
+  const Position&                       pos,
+  AccumulatorState<ThreatFeatureSet>&   accumulatorState,
+  AccumulatorCaches::Cache<Dimensions>& cache);
 }
 
 template<typename T>
@@ -166,10 +171,12 @@ void AccumulatorStack::evaluate_side(Color                                 persp
     const auto last_usable_accum =
       find_last_usable_accumulator<FeatureSet, Dimensions>(perspective);
 
+    std::size_t changed;
+
     if ((accumulators<FeatureSet>()[last_usable_accum].template acc<Dimensions>())
           .computed[perspective])
-        forward_update_incremental<FeatureSet>(perspective, pos, featureTransformer,
-                                               last_usable_accum);
+        changed = forward_update_incremental<FeatureSet>(perspective, pos, featureTransformer,
+                                                         last_usable_accum);
 
     else
     {
@@ -177,11 +184,17 @@ void AccumulatorStack::evaluate_side(Color                                 persp
             update_accumulator_refresh_cache(perspective, featureTransformer, pos,
                                              mut_latest<PSQFeatureSet>(), cache);
         else
-            update_threats_accumulator_full(perspective, featureTransformer, pos,
-                                            mut_latest<ThreatFeatureSet>());
+            update_threats_accumulator_refresh_cache(perspective, featureTransformer, pos,
+                                                     mut_latest<ThreatFeatureSet>(), cache);
 
-        backward_update_incremental<FeatureSet>(perspective, pos, featureTransformer,
-                                                last_usable_accum);
+        changed = backward_update_incremental<FeatureSet>(perspective, pos, featureTransformer,
+                                                          last_usable_accum);
+    }
+
+    if constexpr (std::is_same_v<FeatureSet, ThreatFeatureSet>)
+    {
+        cache.threatStats.updates += size - 1 - last_usable_accum;
+        cache.threatStats.updateFeatures += changed;
     }
 }
 
@@ -203,7 +216,7 @@ std::size_t AccumulatorStack::find_last_usable_accumulator(Color perspective) co
 }
 
 template<typename FeatureSet, IndexType Dimensions>
-void AccumulatorStack::forward_update_incremental(
+std::size_t AccumulatorStack::forward_update_incremental(
   Color                                 perspective,
   const Position&                       pos,
   const FeatureTransformer<Dimensions>& featureTransformer,
@@ -212,7 +225,8 @@ void AccumulatorStack::forward_update_incremental(
     assert(begin < accumulators<FeatureSet>().size());
     assert((accumulators<FeatureSet>()[begin].template acc<Dimensions>()).computed[perspective]);
 
-    const Square ksq = pos.square<KING>(perspective);
+    const Square ksq     = pos.square<KING>(perspective);
+    std::size_t  changed = 0;
 
     for (std::size_t next = begin + 1; next < size; next++)
     {
@@ -228,8 +242,9 @@ void AccumulatorStack::forward_update_incremental(
                 if (dp2.remove_sq != SQ_NONE
                     && (accumulators[next].diff.threateningSqs & square_bb(dp2.remove_sq)))
                 {
-                    double_inc_update(perspective, featureTransformer, ksq, accumulators[next],
-                                      accumulators[next + 1], accumulators[next - 1], dp2);
+                    changed +=
+                      double_inc_update(perspective, featureTransformer, ksq, accumulators[next],
+                                        accumulators[next + 1], accumulators[next - 1], dp2);
                     next++;
                     continue;
                 }
@@ -241,8 +256,9 @@ void AccumulatorStack::forward_update_incremental(
                 {
                     const Square captureSq = dp1.to;
                     dp1.to = dp2.remove_sq = SQ_NONE;
-                    double_inc_update(perspective, featureTransformer, ksq, accumulators[next],
-                                      accumulators[next + 1], accumulators[next - 1]);
+                    changed +=
+                      double_inc_update(perspective, featureTransformer, ksq, accumulators[next],
+                                        accumulators[next + 1], accumulators[next - 1]);
                     dp1.to = dp2.remove_sq = captureSq;
                     next++;
                     continue;
@@ -250,16 +266,17 @@ void AccumulatorStack::forward_update_incremental(
             }
         }
 
-        update_accumulator_incremental<true>(perspective, featureTransformer, ksq,
-                                             mut_accumulators<FeatureSet>()[next],
-                                             accumulators<FeatureSet>()[next - 1]);
+        changed += update_accumulator_incremental<true>(perspective, featureTransformer, ksq,
+                                                        mut_accumulators<FeatureSet>()[next],
+                                                        accumulators<FeatureSet>()[next - 1]);
     }
 
     assert((latest<PSQFeatureSet>().acc<Dimensions>()).computed[perspective]);
+    return changed;
 }
 
 template<typename FeatureSet, IndexType Dimensions>
-void AccumulatorStack::backward_update_incremental(
+std::size_t AccumulatorStack::backward_update_incremental(
   Color perspective,
 
   const Position&                       pos,
@@ -270,14 +287,16 @@ void AccumulatorStack::backward_update_incremental(
     assert(end < size);
     assert((latest<FeatureSet>().template acc<Dimensions>()).computed[perspective]);
 
-    const Square ksq = pos.square<KING>(perspective);
+    const Square ksq     = pos.square<KING>(perspective);
+    std::size_t  changed = 0;
 
     for (std::int64_t next = std::int64_t(size) - 2; next >= std::int64_t(end); next--)
-        update_accumulator_incremental<false>(perspective, featureTransformer, ksq,
-                                              mut_accumulators<FeatureSet>()[next],
-                                              accumulators<FeatureSet>()[next + 1]);
+        changed += update_accumulator_incremental<false>(perspective, featureTransformer, ksq,
+                                                         mut_accumulators<FeatureSet>()[next],
+                                                         accumulators<FeatureSet>()[next + 1]);
 
     assert((accumulators<FeatureSet>()[end].template acc<Dimensions>()).computed[perspective]);
+    return changed;
 }
 
 // Explicit template instantiations
@@ -489,12 +508,13 @@ auto make_accumulator_update_context(Color                                 persp
 }
 
 template<IndexType TransformedFeatureDimensions>
-void double_inc_update(Color                                                   perspective,
-                       const FeatureTransformer<TransformedFeatureDimensions>& featureTransformer,
-                       const Square                                            ksq,
-                       AccumulatorState<PSQFeatureSet>&                        middle_state,
-                       AccumulatorState<PSQFeatureSet>&                        target_state,
-                       const AccumulatorState<PSQFeatureSet>&                  computed) {
+std::size_t
+double_inc_update(Color                                                   perspective,
+                  const FeatureTransformer<TransformedFeatureDimensions>& featureTransformer,
+                  const Square                                            ksq,
+                  AccumulatorState<PSQFeatureSet>&                        middle_state,
+                  AccumulatorState<PSQFeatureSet>&                        target_state,
+                  const AccumulatorState<PSQFeatureSet>&                  computed) {
 
     assert(computed.acc<TransformedFeatureDimensions>().computed[perspective]);
     assert(!middle_state.acc<TransformedFeatureDimensions>().computed[perspective]);
@@ -530,16 +550,19 @@ void double_inc_update(Color                                                   p
     }
 
     target_state.acc<TransformedFeatureDimensions>().computed[perspective] = true;
+
+    return added.size() + removed.size();
 }
 
 template<IndexType TransformedFeatureDimensions>
-void double_inc_update(Color                                                   perspective,
-                       const FeatureTransformer<TransformedFeatureDimensions>& featureTransformer,
-                       const Square                                            ksq,
-                       AccumulatorState<ThreatFeatureSet>&                     middle_state,
-                       AccumulatorState<ThreatFeatureSet>&                     target_state,
-                       const AccumulatorState<ThreatFeatureSet>&               computed,
-                       const DirtyPiece&                                       dp2) {
+std::size_t
+double_inc_update(Color                                                   perspective,
+                  const FeatureTransformer<TransformedFeatureDimensions>& featureTransformer,
+                  const Square                                            ksq,
+                  AccumulatorState<ThreatFeatureSet>&                     middle_state,
+                  AccumulatorState<ThreatFeatureSet>&                     target_state,
+                  const AccumulatorState<ThreatFeatureSet>&               computed,
+                  const DirtyPiece&                                       dp2) {
 
     assert(computed.acc<TransformedFeatureDimensions>().computed[perspective]);
     assert(!middle_state.acc<TransformedFeatureDimensions>().computed[perspective]);
@@ -561,10 +584,12 @@ void double_inc_update(Color                                                   p
     updateContext.apply(added, removed);
 
     target_state.acc<TransformedFeatureDimensions>().computed[perspective] = true;
+
+    return added.size() + removed.size();
 }
 
 template<bool Forward, typename FeatureSet, IndexType TransformedFeatureDimensions>
-void update_accumulator_incremental(
+std::size_t update_accumulator_incremental(
   Color                                                   perspective,
   const FeatureTransformer<TransformedFeatureDimensions>& featureTransformer,
   const Square                                            ksq,
@@ -628,6 +653,8 @@ void update_accumulator_incremental(
     }
 
     (target_state.template acc<TransformedFeatureDimensions>()).computed[perspective] = true;
+
+    return added.size() + removed.size();
 }
 
 Bitboard get_changed_pieces(const std::array<Piece, SQUARE_NB>& oldPieces,
@@ -806,14 +833,46 @@ void update_accumulator_refresh_cache(Color                                 pers
 }
 
 template<IndexType Dimensions>
-void update_threats_accumulator_full(Color                                 perspective,
-                                     const FeatureTransformer<Dimensions>& featureTransformer,
-                                     const Position&                       pos,
-                                     AccumulatorState<ThreatFeatureSet>&   accumulatorState) {
+void update_threats_accumulator_refresh_cache(
+  Color                                 perspective,
+  const FeatureTransformer<Dimensions>& featureTransformer,
+  const Position&                       pos,
+  AccumulatorState<ThreatFeatureSet>&   accumulatorState,
+  AccumulatorCaches::Cache<Dimensions>& cache) {
+
     using Tiling [[maybe_unused]] = SIMDTiling<Dimensions, Dimensions, PSQTBuckets>;
 
-    ThreatFeatureSet::IndexList active;
+    const Square                ksq   = pos.square<KING>(perspective);
+    auto&                       entry = cache.threat_entry(perspective, ksq);
+    ThreatFeatureSet::IndexList active, removed, added;
+
     ThreatFeatureSet::append_active_indices(perspective, pos, active);
+    std::sort(active.begin(), active.end());
+
+    // Both lists are sorted, so a single merge pass finds the difference
+    for (std::size_t i = 0, j = 0; i < entry.active.size() || j < active.size();)
+    {
+        if (j == active.size() || (i < entry.active.size() && entry.active[i] < active[j]))
+            removed.push_back(entry.active[i++]);
+        else if (i == entry.active.size() || active[j] < entry.active[i])
+            added.push_back(active[j++]);
+        else
+            ++i, ++j;
+    }
+
+    // Rebuild the entry from scratch when that touches fewer columns
+    if (removed.size() + added.size() >= active.size())
+    {
+        entry.clear();
+        removed = {};
+        added   = active;
+    }
+
+    entry.active = active;
+
+    cache.threatStats.refreshes++;
+    cache.threatStats.refreshFeatures += removed.size() + added.size();
+    cache.threatStats.activeFeatures += active.size();
 
     auto& accumulator                 = accumulatorState.acc<Dimensions>();
     accumulator.computed[perspective] = true;
@@ -826,15 +885,33 @@ void update_threats_accumulator_full(Color                                 persp
     {
         auto* accTile =
           reinterpret_cast<vec_t*>(&accumulator.accumulation[perspective][j * Tiling::TileHeight]);
+        auto* entryTile = reinterpret_cast<vec_t*>(&entry.accumulation[j * Tiling::TileHeight]);
 
         for (IndexType k = 0; k < Tiling::NumRegs; ++k)
-            acc[k] = vec_zero();
+            acc[k] = entryTile[k];
 
-        IndexType i = 0;
+        for (IndexType i = 0; i < removed.size(); ++i)
+        {
+            IndexType       index  = removed[i];
+            const IndexType offset = Dimensions * index + j * Tiling::TileHeight;
+            auto*           column =
+              reinterpret_cast<const vec_i8_t*>(&featureTransformer.threatWeights[offset]);
 
-        for (; i < active.size(); ++i)
+    #ifdef USE_NEON
+            for (IndexType k = 0; k < Tiling::NumRegs; k += 2)
+            {
+                acc[k]     = vec_sub_16(acc[k], vmovl_s8(vget_low_s8(column[k / 2])));
+                acc[k + 1] = vec_sub_16(acc[k + 1], vmovl_high_s8(column[k / 2]));
+            }
+    #else
+            for (IndexType k = 0; k < Tiling::NumRegs; ++k)
+                acc[k] = vec_sub_16(acc[k], vec_convert_8_16(column[k]));
+    #endif
+        }
+
+        for (IndexType i = 0; i < added.size(); ++i)
         {
-            IndexType       index  = active[i];
+            IndexType       index  = added[i];
             const IndexType offset = Dimensions * index + j * Tiling::TileHeight;
             auto*           column =
               reinterpret_cast<const vec_i8_t*>(&featureTransformer.threatWeights[offset]);
@@ -851,6 +928,8 @@ void update_threats_accumulator_full(Color                                 persp
     #endif
         }
 
+        for (IndexType k = 0; k < Tiling::NumRegs; k++)
+            vec_store(&entryTile[k], acc[k]);
         for (IndexType k = 0; k < Tiling::NumRegs; k++)
             vec_store(&accTile[k], acc[k]);
     }
@@ -859,13 +938,25 @@ void update_threats_accumulator_full(Color                                 persp
     {
         auto* accTilePsqt = reinterpret_cast<psqt_vec_t*>(
           &accumulator.psqtAccumulation[perspective][j * Tiling::PsqtTileHeight]);
+        auto* entryTilePsqt =
+          reinterpret_cast<psqt_vec_t*>(&entry.psqtAccumulation[j * Tiling::PsqtTileHeight]);
 
         for (IndexType k = 0; k < Tiling::NumPsqtRegs; ++k)
-            psqt[k] = vec_zero_psqt();
+            psqt[k] = entryTilePsqt[k];
 
-        for (IndexType i = 0; i < active.size(); ++i)
+        for (IndexType i = 0; i < removed.size(); ++i)
         {
-            IndexType       index  = active[i];
+            IndexType       index  = removed[i];
+            const IndexType offset = PSQTBuckets * index + j * Tiling::PsqtTileHeight;
+            auto*           columnPsqt =
+              reinterpret_cast<const psqt_vec_t*>(&featureTransformer.threatPsqtWeights[offset]);
+
+            for (std::size_t k = 0; k < Tiling::NumPsqtRegs; ++k)
+                psqt[k] = vec_sub_psqt_32(psqt[k], columnPsqt[k]);
+        }
+        for (IndexType i = 0; i < added.size(); ++i)
+        {
+            IndexType       index  = added[i];
             const IndexType offset = PSQTBuckets * index + j * Tiling::PsqtTileHeight;
             auto*           columnPsqt =
               reinterpret_cast<const psqt_vec_t*>(&featureTransformer.threatPsqtWeights[offset]);
@@ -874,31 +965,38 @@ void update_threats_accumulator_full(Color                                 persp
                 psqt[k] = vec_add_psqt_32(psqt[k], columnPsqt[k]);
         }
 
+        for (IndexType k = 0; k < Tiling::NumPsqtRegs; ++k)
+            vec_store_psqt(&entryTilePsqt[k], psqt[k]);
         for (IndexType k = 0; k < Tiling::NumPsqtRegs; ++k)
             vec_store_psqt(&accTilePsqt[k], psqt[k]);
     }
 
 #else
 
-    for (IndexType j = 0; j < Dimensions; ++j)
-        accumulator.accumulation[perspective][j] = 0;
-
-    for (std::size_t k = 0; k < PSQTBuckets; ++k)
-        accumulator.psqtAccumulation[perspective][k] = 0;
-
-    for (const auto index : active)
+    for (const auto index : removed)
     {
         const IndexType offset = Dimensions * index;
+        for (IndexType j = 0; j < Dimensions; ++j)
+            entry.accumulation[j] -= featureTransformer.threatWeights[offset + j];
 
+        for (std::size_t k = 0; k < PSQTBuckets; ++k)
+            entry.psqtAccumulation[k] -=
+              featureTransformer.threatPsqtWeights[index * PSQTBuckets + k];
+    }
+    for (const auto index : added)
+    {
+        const IndexType offset = Dimensions * index;
         for (IndexType j = 0; j < Dimensions; ++j)
-            accumulator.accumulation[perspective][j] +=
-              featureTransformer.threatWeights[offset + j];
+            entry.accumulation[j] += featureTransformer.threatWeights[offset + j];
 
         for (std::size_t k = 0; k < PSQTBuckets; ++k)
-            accumulator.psqtAccumulation[perspective][k] +=
+            entry.psqtAccumulation[k] +=
               featureTransformer.threatPsqtWeights[index * PSQTBuckets + k];
     }
 
+    accumulator.accumulation[perspective]     = entry.accumulation;
+    accumulator.psqtAccumulation[perspective] = entry.psqtAccumulation;
+
 #endif
 }
 
@@ -83,16 +83,52 @@ struct AccumulatorCaches {
             }
         };
 
+        // Same idea for the threat features, which only depend on the king square
+        // through the half of the board the king is on, so two entries per
+        // perspective are enough. An entry keeps its list of active features, the
+        // refresh applies the difference to the current list. Unused by networks
+        // without threat features.
+        struct alignas(CacheLineSize) ThreatEntry {
+            std::array<BiasType, Size>              accumulation;
+            std::array<PSQTWeightType, PSQTBuckets> psqtAccumulation;
+            ThreatFeatureSet::IndexList             active;
+
+            void clear() {
+                accumulation.fill(0);
+                psqtAccumulation.fill(0);
+                active = {};
+            }
+        };
+
+        // Cost of the threat accumulator updates, in number of accumulators
+        // updated and of feature columns added or subtracted
+        struct ThreatStats {
+            std::uint64_t updates = 0, updateFeatures = 0;
+            std::uint64_t refreshes = 0, refreshFeatures = 0, activeFeatures = 0;
+        };
+
         template<typename Network>
         void clear(const Network& network) {
             for (auto& entries1D : entries)
                 for (auto& entry : entries1D)
                     entry.clear(network.featureTransformer.biases);
+
+            for (auto& threatEntries1D : threatEntries)
+                for (auto& entry : threatEntries1D)
+                    entry.clear();
+
+            threatStats = {};
         }
 
         std::array<Entry, COLOR_NB>& operator[](Square sq) { return entries[sq]; }
 
+        ThreatEntry& threat_entry(Color perspective, Square ksq) {
+            return threatEntries[perspective][file_of(ksq) >= FILE_E];
+        }
+
         std::array<std::array<Entry, COLOR_NB>, SQUARE_NB> entries;
+        std::array<std::array<ThreatEntry, 2>, COLOR_NB>   threatEntries;
+        ThreatStats                                        threatStats;
     };
 
     template<typename Networks>
@@ -185,17 +221,19 @@ class AccumulatorStack {
     template<typename FeatureSet, IndexType Dimensions>
     [[nodiscard]] std::size_t find_last_usable_accumulator(Color perspective) const noexcept;
 
+    // Both return the number of feature columns added or subtracted
     template<typename FeatureSet, IndexType Dimensions>
-    void forward_update_incremental(Color                                 perspective,
-                                    const Position&                       pos,
-                                    const FeatureTransformer<Dimensions>& featureTransformer,
-                                    const std::size_t                     begin) noexcept;
+    std::size_t forward_update_incremental(Color                                 perspective,
+                                           const Position&                       pos,
+                                           const FeatureTransformer<Dimensions>& featureTransformer,
+                                           const std::size_t                     begin) noexcept;
 
     template<typename FeatureSet, IndexType Dimensions>
-    void backward_update_incremental(Color                                 perspective,
-                                     const Position&                       pos,
-                                     const FeatureTransformer<Dimensions>& featureTransformer,
-                                     const std::size_t                     end) noexcept;
+    std::size_t
+    backward_update_incremental(Color                                 perspective,
+                                const Position&                       pos,
+                                const FeatureTransformer<Dimensions>& featureTransformer,
+                                const std::size_t                     end) noexcept;
 
     std::array<AccumulatorState<PSQFeatureSet>, MaxSize>    psq_accumulators;
     std::array<AccumulatorState<ThreatFeatureSet>, MaxSize> threat_accumulators;
@@ -21,9 +21,13 @@
 #ifndef NNUE_ARCHITECTURE_H_INCLUDED
 #define NNUE_ARCHITECTURE_H_INCLUDED
 
+#include <array>
+#include <cassert>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <iosfwd>
+#include <memory>
 
 #include "features/half_ka_v2_hm.h"
 #include "features/full_threats.h"
@@ -51,6 +55,9 @@ constexpr int       L3Small                           = 32;
 constexpr IndexType PSQTBuckets = 8;
 constexpr IndexType LayerStacks = 8;
 
+// Maximum number of positions propagated together by the batched evaluation
+constexpr IndexType EvalBatchSize = 32;
+
 // If vector instructions are enabled, we update and refresh the
 // accumulator tile by tile such that each tile fits in the CPU's
 // vector registers.
@@ -99,18 +106,19 @@ struct NetworkArchitecture {
             && fc_2.write_parameters(stream);
     }
 
+    struct alignas(CacheLineSize) Buffer {
+        alignas(CacheLineSize) typename decltype(fc_0)::OutputBuffer fc_0_out;
+        alignas(CacheLineSize) typename decltype(ac_sqr_0)::OutputType
+          ac_sqr_0_out[ceil_to_multiple<IndexType>(FC_0_OUTPUTS * 2, 32)];
+        alignas(CacheLineSize) typename decltype(ac_0)::OutputBuffer ac_0_out;
+        alignas(CacheLineSize) typename decltype(fc_1)::OutputBuffer fc_1_out;
+        alignas(CacheLineSize) typename decltype(ac_1)::OutputBuffer ac_1_out;
+        alignas(CacheLineSize) typename decltype(fc_2)::OutputBuffer fc_2_out;
+
+        Buffer() { std::memset(this, 0, sizeof(*this)); }
+    };
+
     std::int32_t propagate(const TransformedFeatureType* transformedFeatures) const {
-        struct alignas(CacheLineSize) Buffer {
-            alignas(CacheLineSize) typename decltype(fc_0)::OutputBuffer fc_0_out;
-            alignas(CacheLineSize) typename decltype(ac_sqr_0)::OutputType
-              ac_sqr_0_out[ceil_to_multiple<IndexType>(FC_0_OUTPUTS * 2, 32)];
-            alignas(CacheLineSize) typename decltype(ac_0)::OutputBuffer ac_0_out;
-            alignas(CacheLineSize) typename decltype(fc_1)::OutputBuffer fc_1_out;
-            alignas(CacheLineSize) typename decltype(ac_1)::OutputBuffer ac_1_out;
-            alignas(CacheLineSize) typename decltype(fc_2)::OutputBuffer fc_2_out;
-
-            Buffer() { std::memset(this, 0, sizeof(*this)); }
-        };
 
 #if defined(__clang__) && (__APPLE__)
         // workaround for a bug reported with xcode 12
@@ -130,13 +138,40 @@ struct NetworkArchitecture {
         ac_1.propagate(buffer.fc_1_out, buffer.ac_1_out);
         fc_2.propagate(buffer.ac_1_out, buffer.fc_2_out);
 
-        // buffer.fc_0_out[FC_0_OUTPUTS] is such that 1.0 is equal to 127*(1<<WeightScaleBits) in
-        // quantized form, but we want 1.0 to be equal to 600*OutputScale
-        std::int32_t fwdOut =
-          (buffer.fc_0_out[FC_0_OUTPUTS]) * (600 * OutputScale) / (127 * (1 << WeightScaleBits));
-        std::int32_t outputValue = buffer.fc_2_out[0] + fwdOut;
+        return output_value(buffer);
+    }
 
-        return outputValue;
+    // Same as propagate(), but runs each layer over the whole batch before moving
+    // on to the next one, so that the weights of a layer are brought into cache
+    // once per batch instead of once per position.
+    void propagate_batch(const TransformedFeatureType* const* transformedFeatures,
+                         std::size_t                          count,
+                         std::int32_t*                        output) const {
+        assert(count <= EvalBatchSize);
+
+        // Heap-allocated: EvalBatchSize buffers are too large for thread_local
+        // storage on some platforms.
+        static thread_local auto tlsBuffers = std::make_unique<std::array<Buffer, EvalBatchSize>>();
+        auto& buffers = *tlsBuffers;
+
+        for (std::size_t i = 0; i < count; ++i)
+            fc_0.propagate(transformedFeatures[i], buffers[i].fc_0_out);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            ac_sqr_0.propagate(buffers[i].fc_0_out, buffers[i].ac_sqr_0_out);
+            ac_0.propagate(buffers[i].fc_0_out, buffers[i].ac_0_out);
+            std::memcpy(buffers[i].ac_sqr_0_out + FC_0_OUTPUTS, buffers[i].ac_0_out,
+                        FC_0_OUTPUTS * sizeof(typename decltype(ac_0)::OutputType));
+        }
+        for (std::size_t i = 0; i < count; ++i)
+            fc_1.propagate(buffers[i].ac_sqr_0_out, buffers[i].fc_1_out);
+        for (std::size_t i = 0; i < count; ++i)
+            ac_1.propagate(buffers[i].fc_1_out, buffers[i].ac_1_out);
+        for (std::size_t i = 0; i < count; ++i)
+            fc_2.propagate(buffers[i].ac_1_out, buffers[i].fc_2_out);
+
+        for (std::size_t i = 0; i < count; ++i)
+            output[i] = output_value(buffers[i]);
     }
 
     std::size_t get_content_hash() const {
@@ -150,6 +185,17 @@ struct NetworkArchitecture {
         hash_combine(h, get_hash_value());
         return h;
     }
+
+   private:
+    std::int32_t output_value(const Buffer& buffer) const {
+        // buffer.fc_0_out[FC_0_OUTPUTS] is such that 1.0 is equal to 127*(1<<WeightScaleBits) in
+        // quantized form, but we want 1.0 to be equal to 600*OutputScale
+        std::int32_t fwdOut =
+          (buffer.fc_0_out[FC_0_OUTPUTS]) * (600 * OutputScale) / (127 * (1 << WeightScaleBits));
+        std::int32_t outputValue = buffer.fc_2_out[0] + fwdOut;
+
+        return outputValue;
+    }
 };
 
 }  // namespace Stockfish::Eval::NNUE
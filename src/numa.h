@@ -813,6 +813,84 @@ class NumaConfig {
         return ns;
     }
 
+    // Returns the logical processors of each physical core, read from the SMT
+    // sibling lists in sysfs, ordered by their first processor. Without this
+    // information, e.g. on Windows, each processor is reported as its own core.
+    std::vector<std::vector<CpuIndex>> physical_cores() const {
+        std::vector<std::vector<CpuIndex>> cores;
+        std::set<CpuIndex>                 seen;
+
+        for (const auto& [c, n] : nodeByCpu)
+        {
+            if (seen.count(c))
+                continue;
+
+            std::vector<CpuIndex> core{c};
+
+#if defined(__linux__) && !defined(__ANDROID__)
+
+            // /sys/devices/system/cpu/cpu.../topology/thread_siblings_list
+            std::string path = std::string("/sys/devices/system/cpu/cpu") + std::to_string(c)
+                             + "/topology/thread_siblings_list";
+            auto siblingsStr = read_file_to_string(path);
+            if (siblingsStr.has_value())
+            {
+                remove_whitespace(*siblingsStr);
+                for (size_t s : indices_from_shortened_string(*siblingsStr))
+                {
+                    // Siblings outside of our affinity or of the node are not ours to use
+                    auto it = nodeByCpu.find(s);
+                    if (s != c && it != nodeByCpu.end() && it->second == n && !seen.count(s))
+                        core.push_back(s);
+                }
+            }
+
+#endif
+
+            seen.insert(core.begin(), core.end());
+            cores.emplace_back(std::move(core));
+        }
+
+        return cores;
+    }
+
+    // Binds the current thread to a single processor, which must belong to this
+    // config. Only supported on Linux, elsewhere the thread is bound to the NUMA
+    // node of the processor instead.
+    NumaReplicatedAccessToken bind_current_thread_to_cpu(CpuIndex c) const {
+        const auto it = nodeByCpu.find(c);
+        if (it == nodeByCpu.end())
+            std::exit(EXIT_FAILURE);
+
+#if defined(__linux__) && !defined(__ANDROID__)
+
+        cpu_set_t* mask = CPU_ALLOC(highestCpuIndex + 1);
+        if (mask == nullptr)
+            std::exit(EXIT_FAILURE);
+
+        const size_t masksize = CPU_ALLOC_SIZE(highestCpuIndex + 1);
+
+        CPU_ZERO_S(masksize, mask);
+        CPU_SET_S(c, masksize, mask);
+
+        const int status = sched_setaffinity(0, masksize, mask);
+
+        CPU_FREE(mask);
+
+        if (status != 0)
+            std::exit(EXIT_FAILURE);
+
+        sched_yield();
+
+        return NumaReplicatedAccessToken(it->second);
+
+#else
+
+        return bind_current_thread_to_numa_node(it->second);
+
+#endif
+    }
+
     NumaReplicatedAccessToken bind_current_thread_to_numa_node(NumaIndex n) const {
         if (n >= nodes.size() || nodes[n].size() == 0)
             std::exit(EXIT_FAILURE);
@@ -169,7 +169,8 @@ Option& Option::operator=(const std::string& v) {
         std::string        token;
         std::istringstream ss(defaultValue);
         while (ss >> token)
-            comboMap.add(token, Option());
+            if (!comboMap.count(token))  // "var" and the default are listed several times
+                comboMap.add(token, Option());
         if (!comboMap.count(v) || v == "var")
             return *this;
     }
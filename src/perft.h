@@ -19,10 +19,17 @@
 #ifndef PERFT_H_INCLUDED
 #define PERFT_H_INCLUDED
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <string>
+#include <vector>
 
+#include "memory.h"
+#include "misc.h"
 #include "movegen.h"
 #include "position.h"
+#include "thread.h"
 #include "types.h"
 #include "move_conversion.h"
 
@@ -62,6 +69,162 @@ inline uint64_t perft(const std::string& fen, Depth depth, bool isChess960) {
 
     return perft<true>(p, depth);
 }
+
+// PerftTable is a lock-free hash table of subtree sizes, keyed by position key and
+// depth and shared by all the perft threads. Each entry stores the key xor the
+// data next to the data, so an entry torn by two threads writing it at the same
+// time fails the key check instead of returning a wrong count.
+class PerftTable {
+
+    struct Entry {
+        std::atomic<uint64_t> check{0}, data{0};  // data = nodes << 8 | depth
+    };
+
+    static Key mix(Key key, Depth depth) { return key ^ (uint64_t(depth) * 0x9E3779B97F4A7C15ULL); }
+
+   public:
+    // Size of the table of the "go perft" command, independent of the Hash option
+    static constexpr size_t DefaultMB = 16;
+
+    explicit PerftTable(size_t mb) {
+        size = 1;
+        while (size * 2 * sizeof(Entry) <= mb * 1024 * 1024)
+            size *= 2;
+        entries = make_unique_large_page<Entry[]>(size);
+    }
+
+    bool probe(Key key, Depth depth, uint64_t& nodes) const {
+        const Entry& e    = entries[mix(key, depth) & (size - 1)];
+        uint64_t     data = e.data.load(std::memory_order_relaxed);
+
+        if ((e.check.load(std::memory_order_relaxed) ^ data) != key
+            || (data & 0xFF) != uint64_t(depth))
+            return false;
+
+        nodes = data >> 8;
+        return true;
+    }
+
+    void store(Key key, Depth depth, uint64_t nodes) {
+        Entry&   e    = entries[mix(key, depth) & (size - 1)];
+        uint64_t data = nodes << 8 | uint64_t(depth);
+
+        e.check.store(key ^ data, std::memory_order_relaxed);
+        e.data.store(data, std::memory_order_relaxed);
+    }
+
+   private:
+    size_t                size;
+    LargePagePtr<Entry[]> entries;
+};
+
+// Hashed perft with bulk counting: the moves of the last ply are counted, not made,
+// and the sizes of the subtrees already counted are taken from the table.
+inline uint64_t perft_hashed(Position& pos, Depth depth, PerftTable* table) {
+
+    if (depth <= 1)
+        return MoveList<LEGAL>(pos).size();
+
+    uint64_t nodes;
+    if (table && table->probe(pos.key(), depth, nodes))
+        return nodes;
+
+    StateInfo st;
+    nodes = 0;
+
+    for (const auto& m : MoveList<LEGAL>(pos))
+    {
+        pos.do_move(m, st);
+        nodes += perft_hashed(pos, depth - 1, table);
+        pos.undo_move(m);
+    }
+
+    if (table)
+        table->store(pos.key(), depth, nodes);
+
+    return nodes;
+}
+
+// Parallel perft. The subtrees of the root moves, or of the moves of the first two
+// plies when deep enough to keep all the threads busy until the end, are counted
+// by the threads of the pool, each taking the next subtree not counted yet.
+inline uint64_t perft(ThreadPool&        threads,
+                      const std::string& fen,
+                      Depth              depth,
+                      bool               isChess960,
+                      PerftTable*        table,
+                      bool               verbose) {
+
+    struct Subtree {
+        size_t rootIdx;
+        Move   moves[2];
+    };
+
+    StateInfo rootSt, st;
+    Position  root;
+    root.set(fen, isChess960, &rootSt);
+
+    const bool                         split2 = depth >= 4;
+    std::vector<Move>                  rootMoves;
+    std::vector<Subtree>               subtrees;
+    std::vector<std::atomic<uint64_t>> counts(MAX_MOVES);
+
+    for (const auto& m : MoveList<LEGAL>(root))
+    {
+        rootMoves.push_back(m);
+
+        if (!split2)
+        {
+            subtrees.push_back({rootMoves.size() - 1, {m, Move::none()}});
+            continue;
+        }
+
+        root.do_move(m, st);
+        for (const auto& r : MoveList<LEGAL>(root))
+            subtrees.push_back({rootMoves.size() - 1, {m, r}});
+        root.undo_move(m);
+    }
+
+    std::atomic<size_t> next(0);
+
+    auto job = [&]() {
+        StateInfo states[3];
+        Position  pos;
+        pos.set(fen, isChess960, &states[0]);
+
+        for (size_t i; (i = next++) < subtrees.size();)
+        {
+            const Subtree& s     = subtrees[i];
+            int            plies = s.moves[1] ? 2 : 1;
+
+            for (int ply = 0; ply < plies; ++ply)
+                pos.do_move(s.moves[ply], states[ply + 1]);
+
+            uint64_t nodes = depth > plies ? perft_hashed(pos, depth - plies, table)
+                                           : depth == plies ? 1 : 0;
+
+            for (int ply = plies - 1; ply >= 0; --ply)
+                pos.undo_move(s.moves[ply]);
+
+            counts[s.rootIdx] += nodes;
+        }
+    };
+
+    for (size_t i = 0; i < threads.num_threads(); ++i)
+        threads.run_on_thread(i, job);
+
+    for (size_t i = 0; i < threads.num_threads(); ++i)
+        threads.wait_on_thread(i);
+
+    uint64_t nodes = 0;
+    for (size_t i = 0; i < rootMoves.size(); ++i)
+    {
+        nodes += counts[i];
+        if (verbose)
+            sync_cout << move_to_string(rootMoves[i], isChess960) << ": " << counts[i] << sync_endl;
+    }
+    return nodes;
+}
 }
 
 #endif  // PERFT_H_INCLUDED
@@ -27,9 +27,11 @@
 #include <initializer_list>
 #include <iomanip>
 #include <iostream>
+#include <mutex>
 #include <sstream>
 #include <string_view>
 #include <utility>
+#include <vector>
 
 #include "bitboard.h"
 #include "misc.h"
@@ -57,9 +59,63 @@ constexpr std::string_view PieceToChar(" PNBRQK  pnbrqk");
 
 static constexpr Piece Pieces[] = {W_PAWN, W_KNIGHT, W_BISHOP, W_ROOK, W_QUEEN, W_KING,
                                    B_PAWN, B_KNIGHT, B_BISHOP, B_ROOK, B_QUEEN, B_KING};
+
+// Lists dropped by their owners, reused by make_state_list(). Never destroyed,
+// so that lists can still be dropped during static destruction.
+struct FreeStateLists {
+    static constexpr std::size_t MaxSize = 16;
+
+    FreeStateLists() { lists.reserve(MaxSize); }
+
+    std::mutex              mutex;
+    std::vector<StateList*> lists;
+};
+
+FreeStateLists& free_state_lists() {
+    static FreeStateLists* freeLists = new FreeStateLists();
+    return *freeLists;
+}
 }  // namespace
 
 
+void StateListDeleter::operator()(StateList* list) const {
+
+    FreeStateLists& freeLists = free_state_lists();
+    {
+        std::scoped_lock<std::mutex> lk(freeLists.mutex);
+
+        if (freeLists.lists.size() < FreeStateLists::MaxSize)
+        {
+            freeLists.lists.push_back(list);
+            return;
+        }
+    }
+    delete list;
+}
+
+StateListPtr make_state_list() {
+
+    FreeStateLists& freeLists = free_state_lists();
+    StateList*      list      = nullptr;
+    {
+        std::scoped_lock<std::mutex> lk(freeLists.mutex);
+
+        if (!freeLists.lists.empty())
+        {
+            list = freeLists.lists.back();
+            freeLists.lists.pop_back();
+        }
+    }
+
+    if (!list)
+        list = new StateList();
+
+    list->clear();
+    list->emplace_back();
+    return StateListPtr(list);
+}
+
+
 // Returns an ASCII representation of the position
 std::ostream& operator<<(std::ostream& os, const Position& pos) {
 
@@ -688,6 +744,54 @@ bool Position::gives_check(Move m) const {
 }
 
 
+// Returns the key of the position after the given pseudo-legal move, as do_move()
+// computes it, without making the move. An en passant square set by a double
+// pawn push is left out, so the key is not exact then. Used to prefetch the TT
+// entries of the moves about to be searched.
+Key Position::key_after(Move m) const {
+
+    Color  us       = sideToMove;
+    Square from     = m.from_sq();
+    Square to       = m.to_sq();
+    Piece  pc       = piece_on(from);
+    Piece  captured = m.type_of() == EN_PASSANT ? make_piece(~us, PAWN) : piece_on(to);
+    Key    k        = st->key ^ Zobrist::side;
+    int    rule50   = st->rule50 + 1;
+
+    if (m.type_of() == CASTLING)
+    {
+        Square rto = relative_square(us, to > from ? SQ_F1 : SQ_D1);
+        k ^= Zobrist::psq[captured][to] ^ Zobrist::psq[captured][rto];
+        to = relative_square(us, to > from ? SQ_G1 : SQ_C1);
+    }
+    else if (captured)
+    {
+        k ^= Zobrist::psq[captured][m.type_of() == EN_PASSANT ? to - pawn_push(us) : to];
+        rule50 = 0;
+    }
+
+    k ^= Zobrist::psq[pc][from] ^ Zobrist::psq[pc][to];
+
+    if (st->epSquare != SQ_NONE)
+        k ^= Zobrist::enpassant[file_of(st->epSquare)];
+
+    if (st->castlingRights && (castlingRightsMask[from] | castlingRightsMask[to]))
+        k ^= Zobrist::castling[st->castlingRights]
+           ^ Zobrist::castling[st->castlingRights
+                               & ~(castlingRightsMask[from] | castlingRightsMask[to])];
+
+    if (type_of(pc) == PAWN)
+    {
+        if (m.type_of() == PROMOTION)
+            k ^= Zobrist::psq[make_piece(us, m.promotion_type())][to];
+
+        rule50 = 0;
+    }
+
+    return rule50 < 14 ? k : k ^ make_key((rule50 - 14) / 8);
+}
+
+
 // Makes a move, and saves all information necessary
 // to a StateInfo object. The move is assumed to be legal. Pseudo-legal
 // moves should be filtered out before this function is called.
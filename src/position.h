@@ -21,11 +21,12 @@
 
 #include <array>
 #include <cassert>
-#include <deque>
+#include <cstddef>
 #include <iosfwd>
 #include <memory>
 #include <new>
 #include <string>
+#include <vector>
 
 #include "bitboard.h"
 #include "types.h"
@@ -65,9 +66,46 @@ struct StateInfo {
 
 // A list to keep track of the position states along the setup moves (from the
 // start position to the position just before the search starts). Needed by
-// 'draw by repetition' detection. Use a std::deque because pointers to
-// elements are not invalidated upon list resizing.
-using StateListPtr = std::unique_ptr<std::deque<StateInfo>>;
+// 'draw by repetition' detection. States are stored in cache-aligned blocks of
+// fixed capacity that never move, so pointers to elements are not invalidated
+// upon list resizing. Lists dropped by their owner are recycled, blocks included,
+// by make_state_list(), so setting up positions does not allocate once the lists
+// have grown to the length of the game.
+class StateList {
+   public:
+    static constexpr std::size_t BlockSize = 128;
+
+    StateInfo& back() { return at(count - 1); }
+
+    StateInfo& emplace_back() {
+        if (count == blocks.size() * BlockSize)
+            blocks.push_back(std::make_unique<Block>());
+
+        return at(count++) = StateInfo();
+    }
+
+    std::size_t size() const { return count; }
+    void        clear() { count = 0; }
+
+   private:
+    struct alignas(64) Block {  // Cache line aligned
+        StateInfo states[BlockSize];
+    };
+
+    StateInfo& at(std::size_t i) { return blocks[i / BlockSize]->states[i % BlockSize]; }
+
+    std::vector<std::unique_ptr<Block>> blocks;
+    std::size_t                         count = 0;
+};
+
+struct StateListDeleter {
+    void operator()(StateList* list) const;
+};
+
+using StateListPtr = std::unique_ptr<StateList, StateListDeleter>;
+
+// Returns a list holding a single state, ready for Position::set()
+StateListPtr make_state_list();
 
 
 // Position class stores information regarding the board representation as
@@ -150,6 +188,7 @@ class Position {
 
     // Accessing hash keys
     Key key() const;
+    Key key_after(Move m) const;
     Key material_key() const;
     Key pawn_key() const;
     Key minor_piece_key() const;
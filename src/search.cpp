@@ -157,6 +157,16 @@ Search::Worker::Worker(SharedState&                    sharedState,
                        std::unique_ptr<ISearchManager> sm,
                        size_t                          threadId,
                        NumaReplicatedAccessToken       token) :
+    continuationHistory(make_unique_large_page<MultiArray<ContinuationHistory, 2>[]>(
+      bool(sharedState.options["CompactHistory"]) ? 1 : 2)),
+    sharedHistories(sharedState.sharedHistories[token].get()),
+    ownHistories(sharedHistories ? nullptr
+                                 : make_unique_large_page<SharedHistories>(pawn_history_size(
+                                     bool(sharedState.options["CompactHistory"])))),
+    pawnHistory(histories().pawnHistory),
+    pawnCorrectionHistory(histories().pawnCorrectionHistory),
+    minorPieceCorrectionHistory(histories().minorPieceCorrectionHistory),
+    nonPawnCorrectionHistory(histories().nonPawnCorrectionHistory),
     // Unpack the SharedState struct into member variables
     threadIdx(threadId),
     numaAccessToken(token),
@@ -165,7 +175,9 @@ Search::Worker::Worker(SharedState&                    sharedState,
     threads(sharedState.threads),
     tt(sharedState.tt),
     networks(sharedState.networks),
-    refreshTable(networks[token]) {
+    timeModel(sharedState.timeModel),
+    refreshTable(networks[token]),
+    compactHistory(sharedState.options["CompactHistory"]) {
     clear();
 }
 
@@ -175,17 +187,90 @@ void Search::Worker::ensure_network_replicated() {
     (void) (networks[numaAccessToken]);
 }
 
+std::vector<std::pair<std::string_view, size_t>> Search::Worker::footprint() const {
+
+    size_t continuation = (compactHistory ? 1 : 2) * sizeof(continuationHistory[0]);
+    size_t pawn         = pawnHistory.size() * sizeof(PawnHistory::Entry);
+
+    // Tables shared with the other threads of the NUMA node are not counted here
+    auto own = [&](size_t size) { return sharedHistories ? 0 : size; };
+
+    std::vector<std::pair<std::string_view, size_t>> tables = {
+      {"Main history", sizeof(mainHistory)},
+      {"Low ply history", sizeof(lowPlyHistory)},
+      {"Capture history", sizeof(captureHistory)},
+      {"Continuation history", continuation},
+      {"Pawn history", own(pawn)},
+      {"Pawn correction history", own(sizeof(pawnCorrectionHistory))},
+      {"Minor piece correction history", own(sizeof(minorPieceCorrectionHistory))},
+      {"Non-pawn correction history", own(sizeof(nonPawnCorrectionHistory))},
+      {"Continuation correction history", sizeof(continuationCorrectionHistory)},
+      {"Accumulator stack", sizeof(accumulatorStack)},
+      {"Accumulator refresh caches", sizeof(refreshTable)}};
+
+    size_t listed = 0;
+    for (const auto& table : tables)
+        listed += table.second;
+
+    // Allocated apart from the worker, with the size of the history layout
+    listed -= continuation + (ownHistories ? ownHistories->footprint() : 0);
+
+    // Allocated apart from the worker, at the first search with the option
+    if (bool(options["EvalCache"]))
+        tables.emplace_back("Eval cache", sizeof(Eval::NNUE::EvalCache));
+    if (bool(options["TTFront"]) && !size_t(options["DeterministicQuantum"]))
+        tables.emplace_back("TT front", sizeof(TTFront));
+
+    tables.emplace_back("Other", sizeof(*this) - listed);
+    return tables;
+}
+
 void Search::Worker::start_searching() {
     accumulatorStack.reset();
 
+    // Allocated by the thread on first use, so on its NUMA node, and dropped when disabled
+    if (!bool(options["EvalCache"]))
+        evalCache.reset();
+    else if (!evalCache)
+    {
+        evalCache = std::make_unique<Eval::NNUE::EvalCache>();
+        evalCache->clear();
+    }
+
+    vectorMovePicker = bool(options["VectorMovePicker"]);
+    ttPrefetchAhead  = int(options["TTPrefetchAhead"]);
+
+    // Allocated by the thread on first use, like the eval cache, and cleared for each search
+    if (!bool(options["TTFront"]) || ttLog)
+        ttFront.reset();
+    else
+    {
+        if (!ttFront)
+            ttFront = std::make_unique<TTFront>();
+        ttFront->clear();
+    }
+
+#ifdef USE_TRACE
+    std::string traceFile = std::string(options["TraceFile"]);
+    if (!traceFile.empty())
+        traceFile += "." + std::to_string(threadIdx);
+
+    if (!trace.open(traceFile))
+        sync_cout << "info string Failed to map the trace file " << traceFile << sync_endl;
+    ++traceSearch;
+#endif
+
     // Non-main threads go directly to iterative_deepening()
     if (!is_mainthread())
     {
         iterative_deepening();
+
+        if (ttLog)
+            threads.synchronize(*this, true);
         return;
     }
 
-    main_manager()->tm.init(limits, rootPos.side_to_move(), rootPos.game_ply(), options,
+    main_manager()->tm.init(limits, rootPos.side_to_move(), rootPos.game_ply(), options, timeModel,
                             main_manager()->originalTimeAdjust);
     tt.new_search();
 
@@ -199,6 +284,10 @@ void Search::Worker::start_searching() {
     {
         threads.start_searching();  // start non-main threads
         iterative_deepening();      // main thread start searching
+
+        // Stops the other threads at their next synchronization point
+        if (ttLog)
+            threads.synchronize(*this, true);
     }
 
     // When we reach the maximum depth, we can arrive here without a raise of
@@ -233,8 +322,9 @@ void Search::Worker::start_searching() {
     main_manager()->bestPreviousScore        = bestThread->rootMoves[0].score;
     main_manager()->bestPreviousAverageScore = bestThread->rootMoves[0].averageScore;
 
-    // Send again PV info if we have a new best thread
-    if (bestThread != this)
+    // Send again PV info if we have a new best thread, or with the final node
+    // count of the deterministic mode
+    if (bestThread != this || ttLog)
         main_manager()->pv(*bestThread, threads, tt, bestThread->completedDepth);
 
     std::string ponder;
@@ -293,12 +383,13 @@ void Search::Worker::iterative_deepening() {
     }
 
     size_t multiPV = size_t(options["MultiPV"]);
-    Skill skill(options["Skill Level"], options["LimitStrength"] ? int(options["Elo"]) : 0);
+    Skill skill(options["Skill Level"], options["LimitStrength"] ? int(options["Elo"]) : 0,
+                options["SkillRescore"]);
 
     // When playing with strength handicap enable MultiPV search that we will
     // use behind-the-scenes to retrieve a set of possible moves.
-    if (skill.enabled())
-        multiPV = std::max(multiPV, size_t(4));
+    if (skill.enabled() && !skill.rescore)
+        multiPV = std::max(multiPV, Skill::Candidates);
     multiPV = std::min(multiPV, rootMoves.size());
     lowPlyHistory.fill(97);
     int searchAgainCounter = 0;
@@ -453,6 +544,9 @@ void Search::Worker::iterative_deepening() {
         if (!mainThread)
             continue;
 
+        Move ponderMove = rootMoves[0].pv.size() > 1 ? rootMoves[0].pv[1] : Move::none();
+        threads.publish_best_move(rootMoves[0].pv[0], ponderMove);
+
         // Have we found a "mate in x"?
         if (limits.mate && rootMoves[0].score == rootMoves[0].uciScore
             && ((rootMoves[0].score >= VALUE_MATE_IN_MAX_PLY
@@ -460,11 +554,14 @@ void Search::Worker::iterative_deepening() {
                 || (rootMoves[0].score != -VALUE_INFINITE
                     && rootMoves[0].score <= VALUE_MATED_IN_MAX_PLY
                     && VALUE_MATE + rootMoves[0].score <= 2 * limits.mate)))
-            threads.stop = true;
+            threads.request_stop();
 
         // If the skill level is enabled and time is up, pick a sub-optimal best move
         if (skill.enabled() && skill.time_to_pick(rootDepth)) {
-            skill.pick_best(rootMoves, multiPV);
+            if (skill.rescore)
+                rescore_for_skill(ss, skill);
+            else
+                skill.pick_best(rootMoves, multiPV);
         }
 
         // Use part of the gained time from a previous stable move for the current move
@@ -497,8 +594,11 @@ void Search::Worker::iterative_deepening() {
 
             double highBestMoveEffort = nodesEffort >= 93340 ? 0.76 : 1.0;
 
-            double totalTime = mainThread->tm.optimum() * fallingEval * reduction
-                             * bestMoveInstability * highBestMoveEffort;
+            double totalTime =
+              mainThread->tm.optimum() * fallingEval * reduction * bestMoveInstability
+              * highBestMoveEffort
+              * mainThread->tm.iteration_scale(totBestMoveChanges / threads.size(),
+                                               nodesEffort / 1000.0);
 
             // Cap used time in case of a single legal move for a better viewer experience
             if (rootMoves.size() == 1)
@@ -514,7 +614,7 @@ void Search::Worker::iterative_deepening() {
                 if (mainThread->ponder)
                     mainThread->stopOnPonderhit = true;
                 else
-                    threads.stop = true;
+                    threads.request_stop();
             }
             else
                 threads.increaseDepth = mainThread->ponder || elapsedTime <= totalTime * 0.50;
@@ -537,6 +637,42 @@ void Search::Worker::iterative_deepening() {
 }
 
 
+// Scores the Skill candidates without a MultiPV search. The root moves after the
+// best one only have an upper bound from the iteration just completed, so they are
+// ranked by a quiescence search, and the best ranked are searched again with a full
+// window at the depth of that iteration. Their subtrees were just searched, thus
+// this mostly reads the transposition table. Leaves skill.best unset when the
+// search is stopped meanwhile.
+void Search::Worker::rescore_for_skill(Stack* ss, Skill& skill) {
+    RootMoves candidates(rootMoves.begin(), rootMoves.end());
+    Move      pv[MAX_PLY + 1];
+    StateInfo st;
+
+    auto rescore = [&](RootMove& rm, Depth depth) {
+        do_move(rootPos, rm.pv[0], st, ss);
+        (ss + 1)->pv = pv;
+        pv[0]        = Move::none();
+        rm.score     = -search<PV>(rootPos, ss + 1, -VALUE_INFINITE, VALUE_INFINITE, depth, false);
+        undo_move(rootPos, rm.pv[0]);
+    };
+
+    for (size_t i = 1; i < candidates.size(); ++i)
+        rescore(candidates[i], 0);
+
+    std::stable_sort(candidates.begin() + 1, candidates.end());
+    candidates.erase(candidates.begin() + std::min(Skill::Candidates, candidates.size()),
+                     candidates.end());
+
+    for (size_t i = 1; i < candidates.size() && rootDepth > 1; ++i)
+        rescore(candidates[i], rootDepth - 1);
+
+    if (threads.stop)
+        return;
+
+    std::stable_sort(candidates.begin(), candidates.end());
+    skill.pick_best(candidates, candidates.size());
+}
+
 void Search::Worker::do_move(Position& pos, const Move move, StateInfo& st, Stack* const ss) {
     do_move(pos, move, st, pos.gives_check(move), ss);
 }
@@ -552,9 +688,11 @@ void Search::Worker::do_move(
 
     if (ss != nullptr)
     {
+        bool inCheck = ss->inCheck && !compactHistory;
+
         ss->currentMove = move;
         ss->continuationHistory =
-          &continuationHistory[ss->inCheck][capture][dirtyPiece.pc][move.to_sq()];
+          &continuationHistory[inCheck][capture][dirtyPiece.pc][move.to_sq()];
         ss->continuationCorrectionHistory =
           &continuationCorrectionHistory[dirtyPiece.pc][move.to_sq()];
     }
@@ -579,18 +717,20 @@ void Search::Worker::undo_null_move(Position& pos) { pos.undo_null_move(); }
 void Search::Worker::clear() {
     mainHistory.fill(68);
     captureHistory.fill(-689);
-    pawnHistory.fill(-1238);
-    pawnCorrectionHistory.fill(5);
-    minorPieceCorrectionHistory.fill(0);
-    nonPawnCorrectionHistory.fill(0);
+    // Shared histories are cleared by ThreadPool::clear(), once per NUMA node
+    if (!sharedHistories)
+        ownHistories->clear();
 
     ttMoveHistory = 0;
 
+    if (evalCache)
+        evalCache->clear();
+
     for (auto& to : continuationCorrectionHistory)
         for (auto& h : to)
             h.fill(8);
 
-    for (bool inCheck : {false, true})
+    for (int inCheck = 0; inCheck <= !compactHistory; ++inCheck)
         for (StatsType c : {NoCaptures, Captures})
             for (auto& to : continuationHistory[inCheck][c])
                 for (auto& h : to)
@@ -616,6 +756,11 @@ Value Search::Worker::search(
     if (depth <= 0)
         return qsearch<PvNode ? PV : NonPV>(pos, ss, alpha, beta);
 
+#ifdef USE_TRACE
+    if (trace.is_open() && !ss->traced)
+        return traced_search<nodeType>(pos, ss, alpha, beta, depth, cutNode);
+#endif
+
     // Limit the depth if extensions made it too large
     depth = std::min(depth, MAX_PLY - 1);
 
@@ -659,6 +804,10 @@ Value Search::Worker::search(
     if (is_mainthread())
         main_manager()->check_time(*this);
 
+    // In the deterministic mode, meet the other threads every quantum of nodes
+    if (ttLog && nodes.load(std::memory_order_relaxed) >= nextSync)
+        threads.synchronize(*this, false);
+
     // Used to send selDepth info to GUI (selDepth counts from 1, ply from 0)
     if (PvNode && selDepth < ss->ply + 1)
         selDepth = ss->ply + 1;
@@ -694,7 +843,8 @@ Value Search::Worker::search(
     // Step 4. Transposition table lookup
     excludedMove                   = ss->excludedMove;
     posKey                         = pos.key();
-    auto [ttHit, ttData, ttWriter] = tt.probe(posKey);
+    auto [ttHit, ttData, ttWriter] = tt.probe(posKey, ttLog.get(), &ttCounters,
+                                              ttFront.get());
     // Need further processing of the saved data
     ss->ttHit    = ttHit;
     ttData.move  = rootNode ? rootMoves[pvIdx].pv[0] : ttHit ? ttData.move : Move::none();
@@ -783,7 +933,8 @@ Value Search::Worker::search(
             {
                 pos.do_move(ttData.move, st);
                 Key nextPosKey                             = pos.key();
-                auto [ttHitNext, ttDataNext, ttWriterNext] = tt.probe(nextPosKey);
+                auto [ttHitNext, ttDataNext, ttWriterNext] =
+                  tt.probe(nextPosKey, ttLog.get(), &ttCounters, ttFront.get());
                 pos.undo_move(ttData.move);
 
                 // Check that the ttValue after the tt move would also trigger a cutoff
@@ -808,7 +959,7 @@ Value Search::Worker::search(
             && pos.rule50_count() == 0 && !pos.can_castle(ANY_CASTLING))
         {
             TB::ProbeState err;
-            TB::WDLScore   wdl = Tablebases::probe_wdl(pos, &err);
+            TB::WDLScore   wdl = Tablebases::probe_wdl(pos, &err, tbConfig.useProbeCache);
 
             // Force check of time on the next occasion
             if (is_mainthread())
@@ -862,7 +1013,7 @@ Value Search::Worker::search(
         mainHistory[~us][((ss - 1)->currentMove).raw()] << evalDiff * 9;
         if (!ttHit && type_of(pos.piece_on(prevSq)) != PAWN
             && ((ss - 1)->currentMove).type_of() != PROMOTION)
-            pawnHistory[pawn_history_index(pos)][pos.piece_on(prevSq)][prevSq] << evalDiff * 13;
+            pawnHistory[pawnHistory.index(pos)][pos.piece_on(prevSq)][prevSq] << evalDiff * 13;
     }
 
 
@@ -994,7 +1145,7 @@ moves_loop:  // When in check, search starts here
 
 
     MovePicker mp(pos, ttData.move, depth, &mainHistory, &lowPlyHistory, &captureHistory, contHist,
-                  &pawnHistory, ss->ply);
+                  &pawnHistory, ss->ply, vectorMovePicker, &tt, ttPrefetchAhead);
 
     value = bestValue;
 
@@ -1083,7 +1234,7 @@ moves_loop:  // When in check, search starts here
             {
                 int history = (*contHist[0])[movedPiece][move.to_sq()]
                             + (*contHist[1])[movedPiece][move.to_sq()]
-                            + pawnHistory[pawn_history_index(pos)][movedPiece][move.to_sq()];
+                            + pawnHistory[pawnHistory.index(pos)][movedPiece][move.to_sq()];
 
                 // Continuation history based pruning
                 if (history < -4083 * depth)
@@ -1436,7 +1587,7 @@ moves_loop:  // When in check, search starts here
         mainHistory[~us][((ss - 1)->currentMove).raw()] << scaledBonus * 243 / 32768;
 
         if (type_of(pos.piece_on(prevSq)) != PAWN && ((ss - 1)->currentMove).type_of() != PROMOTION)
-            pawnHistory[pawn_history_index(pos)][pos.piece_on(prevSq)][prevSq]
+            pawnHistory[pawnHistory.index(pos)][pos.piece_on(prevSq)][prevSq]
               << scaledBonus * 1160 / 32768;
     }
 
@@ -1497,6 +1648,11 @@ Value Search::Worker::qsearch(Position& pos, Stack* ss, Value alpha, Value beta)
     assert(alpha >= -VALUE_INFINITE && alpha < beta && beta <= VALUE_INFINITE);
     assert(PvNode || (alpha == beta - 1));
 
+#ifdef USE_TRACE
+    if (trace.is_open() && !ss->traced)
+        return traced_search<nodeType>(pos, ss, alpha, beta, 0, false);
+#endif
+
     // Check if we have an upcoming move that draws by repetition
     if (alpha < VALUE_DRAW && pos.upcoming_repetition(ss->ply))
     {
@@ -1537,7 +1693,8 @@ Value Search::Worker::qsearch(Position& pos, Stack* ss, Value alpha, Value beta)
 
     // Step 3. Transposition table lookup
     posKey                         = pos.key();
-    auto [ttHit, ttData, ttWriter] = tt.probe(posKey);
+    auto [ttHit, ttData, ttWriter] = tt.probe(posKey, ttLog.get(), &ttCounters,
+                                              ttFront.get());
     // Need further processing of the saved data
     ss->ttHit    = ttHit;
     ttData.move  = ttHit ? ttData.move : Move::none();
@@ -1608,7 +1765,7 @@ Value Search::Worker::qsearch(Position& pos, Stack* ss, Value alpha, Value beta)
     // the moves. We presently use two stages of move generator in quiescence search:
     // captures, or evasions only when in check.
     MovePicker mp(pos, ttData.move, DEPTH_QS, &mainHistory, &lowPlyHistory, &captureHistory,
-                  contHist, &pawnHistory, ss->ply);
+                  contHist, &pawnHistory, ss->ply, vectorMovePicker, &tt, ttPrefetchAhead);
 
     // Step 5. Loop through all pseudo-legal moves until no moves remain or a beta
     // cutoff occurs.
@@ -1728,6 +1885,41 @@ Value Search::Worker::qsearch(Position& pos, Stack* ss, Value alpha, Value beta)
     return bestValue;
 }
 
+#ifdef USE_TRACE
+// Searches the node again, flagged so that it is not recorded twice, and
+// records it with the result. Qsearch nodes come with a zero depth.
+template<NodeType nodeType>
+Value Search::Worker::traced_search(
+  Position& pos, Stack* ss, Value alpha, Value beta, Depth depth, bool cutNode) {
+
+    const Move move      = (ss - 1)->currentMove;
+    const int  reduction = (ss - 1)->reduction;
+
+    ss->traced = true;
+    ss->ttHit  = false;
+
+    Value value;
+    if constexpr (nodeType == Root)
+        value = search<Root>(pos, ss, alpha, beta, depth, cutNode);
+    else
+        value = depth > 0 ? search<nodeType>(pos, ss, alpha, beta, depth, cutNode)
+                          : qsearch<nodeType>(pos, ss, alpha, beta);
+
+    ss->traced = false;
+
+    std::uint8_t flags = (nodeType != NonPV ? Trace::PvNode : 0)
+                       | (nodeType == Root ? Trace::RootNode : 0)
+                       | (depth <= 0 ? Trace::QsearchNode : 0) | (cutNode ? Trace::CutNode : 0)
+                       | (ss->ttHit ? Trace::TtHit : 0) | (value >= beta ? Trace::Cutoff : 0);
+
+    trace.record({traceSearch, move.raw(), std::int16_t(alpha), std::int16_t(beta),
+                  std::int16_t(value), std::int8_t(std::min(depth, 127)),
+                  std::int8_t(std::clamp(reduction, -128, 127)), std::uint8_t(ss->ply),
+                  std::uint8_t(rootDepth), flags, 0});
+    return value;
+}
+#endif
+
 Depth Search::Worker::reduction(bool i, Depth d, int mn, int delta) const {
     int reductionScale = reductions[d] * reductions[mn];
     return reductionScale - delta * 608 / rootDelta + !i * reductionScale * 238 / 512 + 1182;
@@ -1749,7 +1941,7 @@ TimePoint Search::Worker::elapsed_time() const { return main_manager()->tm.elaps
 
 Value Search::Worker::evaluate(const Position& pos) {
     return Eval::evaluate(networks[numaAccessToken], pos, accumulatorStack, refreshTable,
-                          optimism[pos.side_to_move()]);
+                          optimism[pos.side_to_move()], evalCache.get());
 }
 
 namespace {
@@ -1889,7 +2081,7 @@ void update_quiet_histories(
 
     update_continuation_histories(ss, pos.moved_piece(move), move.to_sq(), bonus * 896 / 1024);
 
-    int pIndex = pawn_history_index(pos);
+    int pIndex = workerThread.pawnHistory.index(pos);
     workerThread.pawnHistory[pIndex][pos.moved_piece(move)][move.to_sq()]
       << bonus * (bonus > 0 ? 905 : 505) / 1024;
 }
@@ -1957,8 +2149,9 @@ void SearchManager::check_time(Search::Worker& worker) {
       worker.completedDepth >= 1
       && ((worker.limits.use_time_management() && (elapsed > tm.maximum() || stopOnPonderhit))
           || (worker.limits.movetime && elapsed >= worker.limits.movetime)
-          || (worker.limits.nodes && worker.threads.nodes_searched() >= worker.limits.nodes)))
-        worker.threads.stop = worker.threads.abortedSearch = true;
+          || (worker.limits.nodes && !worker.threads.deterministic_quantum()
+              && worker.threads.nodes_searched() >= worker.limits.nodes)))
+        worker.threads.request_stop(true);
 }
 
 // Used to correct and extend PVs for moves that have a TB (but not a mate) score.
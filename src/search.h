@@ -33,6 +33,7 @@
 
 #include "history.h"
 #include "misc.h"
+#include "nnue/eval_cache.h"
 #include "nnue/network.h"
 #include "nnue/nnue_accumulator.h"
 #include "numa.h"
@@ -40,6 +41,8 @@
 #include "score.h"
 #include "syzygy/tbprobe.h"
 #include "timeman.h"
+#include "trace.h"
+#include "tt.h"
 #include "types.h"
 
 namespace Stockfish {
@@ -75,6 +78,9 @@ struct Stack {
     bool                        ttHit;
     int                         cutoffCnt;
     int                         reduction;
+#ifdef USE_TRACE
+    bool traced;  // The search of this node is being recorded
+#endif
 };
 
 
@@ -136,16 +142,22 @@ struct SharedState {
     SharedState(const OptionsMap&                                         optionsMap,
                 ThreadPool&                                               threadPool,
                 TranspositionTable&                                       transpositionTable,
-                const LazyNumaReplicatedSystemWide<Eval::NNUE::Networks>& nets) :
+                const LazyNumaReplicatedSystemWide<Eval::NNUE::Networks>& nets,
+                const NumaReplicated<SharedHistoryTables>&                histories,
+                const TimeModel&                                          model) :
         options(optionsMap),
         threads(threadPool),
         tt(transpositionTable),
-        networks(nets) {}
+        networks(nets),
+        sharedHistories(histories),
+        timeModel(model) {}
 
     const OptionsMap&                                         options;
     ThreadPool&                                               threads;
     TranspositionTable&                                       tt;
     const LazyNumaReplicatedSystemWide<Eval::NNUE::Networks>& networks;
+    const NumaReplicated<SharedHistoryTables>&                sharedHistories;
+    const TimeModel&                                          timeModel;
 };
 
 class Worker;
@@ -188,12 +200,19 @@ struct InfoIteration {
 // Stockfish at various skill levels and various versions of the Stash engine.
 // Skill 0 .. 19 now covers CCRL Blitz Elo from 1320 to 3190, approximately
 // Reference: https://github.com/vondele/Stockfish/commit/a08b8d4e9711c2
+//
+// The candidate moves come from a MultiPV search of Candidates lines by default.
+// With rescore, the search stays single PV and only the candidates are given exact
+// scores, once, at the depth where the move is picked.
 struct Skill {
     // Lowest and highest Elo ratings used in the skill level calculation
     constexpr static int LowestElo  = 1320;
     constexpr static int HighestElo = 3190;
 
-    Skill(int skill_level, int elo) {
+    constexpr static size_t Candidates = 4;
+
+    Skill(int skill_level, int elo, bool rescoreCandidates = false) :
+        rescore(rescoreCandidates) {
         if (elo)
         {
             double e = double(elo - LowestElo) / (HighestElo - LowestElo);
@@ -207,6 +226,7 @@ struct Skill {
     Move pick_best(const RootMoves&, size_t multiPV);
 
     double level;
+    bool   rescore;
     Move   best = Move::none();
 };
 
@@ -278,23 +298,36 @@ class Worker {
 
     void ensure_network_replicated();
 
+    // Bytes used by each table of the worker, with its history layout
+    std::vector<std::pair<std::string_view, size_t>> footprint() const;
+
     // Public because they need to be updatable by the stats
     ButterflyHistory mainHistory;
     LowPlyHistory    lowPlyHistory;
 
     CapturePieceToHistory captureHistory;
-    ContinuationHistory   continuationHistory[2][2];
-    PawnHistory           pawnHistory;
 
-    CorrectionHistory<Pawn>         pawnCorrectionHistory;
-    CorrectionHistory<Minor>        minorPieceCorrectionHistory;
-    CorrectionHistory<NonPawn>      nonPawnCorrectionHistory;
+    // Indexed by [inCheck][capture]. The compact layout only allocates the tables of
+    // the moves made out of check, and uses them for the moves made in check too.
+    LargePagePtr<MultiArray<ContinuationHistory, 2>[]> continuationHistory;
+
+    // The tables of the NUMA node with the SharedHistory option, otherwise null
+    // and the following tables are the own ones of the worker, only allocated then.
+    SharedHistories* const        sharedHistories;
+    LargePagePtr<SharedHistories> ownHistories;
+
+    PawnHistory&                pawnHistory;
+    CorrectionHistory<Pawn>&    pawnCorrectionHistory;
+    CorrectionHistory<Minor>&   minorPieceCorrectionHistory;
+    CorrectionHistory<NonPawn>& nonPawnCorrectionHistory;
+
     CorrectionHistory<Continuation> continuationCorrectionHistory;
 
     TTMoveHistory ttMoveHistory;
 
    private:
     void iterative_deepening();
+    void rescore_for_skill(Stack* ss, Skill& skill);
 
     void do_move(Position& pos, const Move move, StateInfo& st, Stack* const ss);
     void
@@ -330,6 +363,18 @@ class Worker {
     std::atomic<uint64_t> nodes, tbHits, bestMoveChanges;
     int                   selDepth, nmpMinPly;
 
+    // Deterministic search mode: the held back writes to the transposition table,
+    // null when disabled, and the node count of the next synchronization point.
+    std::unique_ptr<TTLog> ttLog;
+    uint64_t               nextSync;
+
+    // Probes and writes of the transposition table in the current search
+    TTCounters ttCounters;
+
+    // Recent shallow entries of the transposition table, probed first. Only with the
+    // TTFront option, and not in the deterministic mode, whose writes are held back.
+    std::unique_ptr<TTFront> ttFront;
+
     Value optimism[COLOR_NB];
 
     Position  rootPos;
@@ -349,14 +394,36 @@ class Worker {
 
     Tablebases::Config tbConfig;
 
+    // Move picker settings, read from the options at the start of each search
+    bool vectorMovePicker;
+    int  ttPrefetchAhead;
+
     const OptionsMap&                                         options;
     ThreadPool&                                               threads;
     TranspositionTable&                                       tt;
     const LazyNumaReplicatedSystemWide<Eval::NNUE::Networks>& networks;
+    const TimeModel&                                          timeModel;
 
     // Used by NNUE
-    Eval::NNUE::AccumulatorStack  accumulatorStack;
-    Eval::NNUE::AccumulatorCaches refreshTable;
+    Eval::NNUE::AccumulatorStack           accumulatorStack;
+    Eval::NNUE::AccumulatorCaches          refreshTable;
+    std::unique_ptr<Eval::NNUE::EvalCache> evalCache;  // Only with the EvalCache option
+
+    // The compact layout shares the continuation histories of the moves made in
+    // and out of check, and uses COMPACT_PAWN_HISTORY_SIZE pawn history entries.
+    const bool compactHistory;
+
+    SharedHistories& histories() { return sharedHistories ? *sharedHistories : *ownHistories; }
+
+#ifdef USE_TRACE
+    // The search tree of this thread, written to the file named after the
+    // TraceFile option and the thread index
+    Trace::Recorder trace;
+    std::uint16_t   traceSearch = 0;
+
+    template<NodeType nodeType>
+    Value traced_search(Position& pos, Stack* ss, Value alpha, Value beta, Depth depth, bool cutNode);
+#endif
 
     friend class Stockfish::ThreadPool;
     friend class SearchManager;
@@ -19,6 +19,7 @@
 #include "tbprobe.h"
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <cassert>
 #include <cstdint>
@@ -28,11 +29,15 @@
 #include <fstream>
 #include <initializer_list>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <sstream>
 #include <string_view>
 #include <sys/stat.h>
+#include <thread>
 #include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -45,6 +50,7 @@
 #include "../option.h"
 
 #ifndef _WIN32
+    #include <dirent.h>
     #include <fcntl.h>
     #include <sys/mman.h>
     #include <unistd.h>
@@ -193,22 +199,20 @@ class TBFile: public std::ifstream {
     std::string fname;
 
    public:
-    // Look for and open the file among the Paths directories where the .rtbw
+    // Look for and open the file among the paths directories where the .rtbw
     // and .rtbz files can be found. Multiple directories are separated by ";"
     // on Windows and by ":" on Unix-based operating systems.
     //
     // Example:
     // C:\tb\wdl345;C:\tb\wdl6;D:\tb\dtz345;D:\tb\dtz6
-    static std::string Paths;
-
-    TBFile(const std::string& f) {
+    TBFile(const std::string& paths, const std::string& f) {
 
 #ifndef _WIN32
         constexpr char SepChar = ':';
 #else
         constexpr char SepChar = ';';
 #endif
-        std::stringstream ss(Paths);
+        std::stringstream ss(paths);
         std::string       path;
 
         while (std::getline(ss, path, SepChar))
@@ -313,8 +317,6 @@ class TBFile: public std::ifstream {
     }
 };
 
-std::string TBFile::Paths;
-
 // struct PairsData contains low-level indexing information to access TB data.
 // There are 8, 4, or 2 PairsData records for each TBTable, according to the type
 // of table and if positions have pawns or not. It is populated at first access.
@@ -352,23 +354,27 @@ struct TBTable {
 
     static constexpr int Sides = Type == WDL ? 2 : 1;
 
-    std::atomic_bool ready;
-    void*            baseAddress;
-    uint8_t*         map;
-    uint64_t         mapping;
-    Key              key;
-    Key              key2;
-    int              pieceCount;
-    bool             hasPawns;
-    bool             hasUniquePieces;
-    uint8_t          pawnCount[2];     // [Lead color / other color]
-    PairsData        items[Sides][4];  // [wtm / btm][FILE_A..FILE_D or 0]
+    std::atomic_bool   ready;
+    std::atomic_bool   warmed;  // Set by the first warm-up of the file
+    void*              baseAddress;
+    uint8_t*           map;
+    uint64_t           mapping;
+    const std::string* paths;  // Of the TBTables owning this table
+    Key                key;
+    Key                key2;
+    int                pieceCount;
+    bool               hasPawns;
+    bool               hasUniquePieces;
+    uint8_t            pawnCount[2];     // [Lead color / other color]
+    PairsData          items[Sides][4];  // [wtm / btm][FILE_A..FILE_D or 0]
 
     PairsData* get(int stm, int f) { return &items[stm % Sides][hasPawns ? f : 0]; }
 
     TBTable() :
         ready(false),
-        baseAddress(nullptr) {}
+        warmed(false),
+        baseAddress(nullptr),
+        paths(nullptr) {}
     explicit TBTable(const std::string& code);
     explicit TBTable(const TBTable<WDL>& wdl);
 
@@ -411,6 +417,7 @@ TBTable<DTZ>::TBTable(const TBTable<WDL>& wdl) :
     TBTable() {
 
     // Use the corresponding WDL table to avoid recalculating all from scratch
+    paths           = wdl.paths;
     key             = wdl.key;
     key2            = wdl.key2;
     pieceCount      = wdl.pieceCount;
@@ -421,8 +428,8 @@ TBTable<DTZ>::TBTable(const TBTable<WDL>& wdl) :
 }
 
 // class TBTables creates and keeps ownership of the TBTable objects, one for
-// each TB file found. It supports a fast, hash-based, table lookup. Populated
-// at init time, accessed at probe time.
+// each TB file found in the given paths. It supports a fast, hash-based, table
+// lookup. Populated at init time, accessed at probe time.
 class TBTables {
 
     struct Entry {
@@ -441,10 +448,17 @@ class TBTables {
 
     Entry hashTable[Size + Overflow];
 
-    std::deque<TBTable<WDL>> wdlTable;
-    std::deque<TBTable<DTZ>> dtzTable;
-    size_t                   foundDTZFiles = 0;
-    size_t                   foundWDLFiles = 0;
+    std::deque<TBTable<WDL>>        wdlTable;
+    std::deque<TBTable<DTZ>>        dtzTable;
+    size_t                          foundDTZFiles  = 0;
+    size_t                          foundWDLFiles  = 0;
+    int                             maxCardinality = 0;
+    bool                            indexed        = false;
+    std::unordered_set<std::string> presentFiles;  // Names of the files in the paths
+
+    bool present(const std::string& f) const {
+        return indexed ? presentFiles.count(f) : TBFile(paths, f).is_open();
+    }
 
     void insert(Key key, TBTable<WDL>* wdl, TBTable<DTZ>* dtz) {
         uint32_t homeBucket = uint32_t(key) & (Size - 1);
@@ -475,6 +489,13 @@ class TBTables {
     }
 
    public:
+    const std::string paths;
+
+    explicit TBTables(const std::string& p) :
+        paths(p) {
+        memset(hashTable, 0, sizeof(hashTable));
+    }
+
     template<TBType Type>
     TBTable<Type>* get(Key key) {
         for (const Entry* entry = &hashTable[uint32_t(key) & (Size - 1)];; ++entry)
@@ -484,23 +505,79 @@ class TBTables {
         }
     }
 
-    void clear() {
-        memset(hashTable, 0, sizeof(hashTable));
-        wdlTable.clear();
-        dtzTable.clear();
-        foundDTZFiles = 0;
-        foundWDLFiles = 0;
-    }
+    int max_cardinality() const { return maxCardinality; }
 
     void info() const {
         sync_cout << "info string Found " << foundWDLFiles << " WDL and " << foundDTZFiles
-                  << " DTZ tablebase files (up to " << MaxCardinality << "-man)." << sync_endl;
+                  << " DTZ tablebase files (up to " << maxCardinality << "-man)." << sync_endl;
     }
 
     void add(const std::vector<PieceType>& pieces);
+    void add_all();
+    void index_files();
+};
+
+// The tables of the current paths, shared by all the engines of the process.
+// Tables of previous paths are retired rather than destroyed when the paths
+// change, another engine may still be probing them.
+std::atomic<TBTables*>                 CurrentTables;
+std::vector<std::unique_ptr<TBTables>> RetiredTables;
+
+// The background warm-up of warm_up(). Kept joinable, so that a warm-up never
+// outlives the process: at exit it is asked to stop and joined.
+struct WarmUpThread {
+    std::thread      thread;
+    std::atomic_bool running, stop;
+
+    ~WarmUpThread() {
+        stop = true;
+        if (thread.joinable())
+            thread.join();
+    }
+};
+
+WarmUpThread WarmUp;
+
+// ProbeCache remembers the results of recent WDL or DTZ probes, so that positions
+// probed again through transpositions, and the 1-ply searches of probe_dtz(), skip
+// the decompression of a block. The result of a probe only depends on the pieces,
+// the side to move and the en passant square, so the position key is a valid tag.
+// Each entry is a single atomic word packing the upper half of the key, the value
+// and the probe state, so concurrent readers never see a torn entry. Entries are
+// always replaced.
+class ProbeCache {
+
+    static constexpr size_t Size = 1 << 16;
+
+    std::atomic<uint64_t> entries[Size];
+
+   public:
+    bool probe(Key key, int* value, ProbeState* result) const {
+        uint64_t e = entries[key & (Size - 1)].load(std::memory_order_relaxed);
+
+        if (!(e & 0xFF) || (e >> 32) != (key >> 32))
+            return false;
+
+        *value  = int16_t(e >> 16);
+        *result = ProbeState(int(e & 0xFF) - 2);
+        return true;
+    }
+
+    void store(Key key, int value, ProbeState result) {
+        if (value < INT16_MIN || value > INT16_MAX)
+            return;
+
+        uint64_t e = (key >> 32 << 32) | uint64_t(uint16_t(value)) << 16 | uint64_t(result + 2);
+        entries[key & (Size - 1)].store(e, std::memory_order_relaxed);
+    }
+
+    void clear() {
+        for (auto& e : entries)
+            e.store(0, std::memory_order_relaxed);
+    }
 };
 
-TBTables TBTables;
+ProbeCache WDLCache, DTZCache;
 
 // If the corresponding file exists two new objects TBTable<WDL> and TBTable<DTZ>
 // are created and added to the lists and hash table. Called at init time.
@@ -512,24 +589,18 @@ void TBTables::add(const std::vector<PieceType>& pieces) {
         code += PieceToChar[pt];
     code.insert(code.find('K', 1), "v");
 
-    TBFile file_dtz(code + ".rtbz");  // KRK -> KRvK
-    if (file_dtz.is_open())
-    {
-        file_dtz.close();
+    if (present(code + ".rtbz"))  // KRK -> KRvK
         foundDTZFiles++;
-    }
-
-    TBFile file(code + ".rtbw");  // KRK -> KRvK
 
-    if (!file.is_open())  // Only WDL file is checked
+    if (!present(code + ".rtbw"))  // Only WDL file is checked
         return;
 
-    file.close();
     foundWDLFiles++;
 
-    MaxCardinality = std::max(int(pieces.size()), MaxCardinality);
+    maxCardinality = std::max(int(pieces.size()), maxCardinality);
 
     wdlTable.emplace_back(code);
+    wdlTable.back().paths = &paths;
     dtzTable.emplace_back(wdlTable.back());
 
     // Insert into the hash keys for both colors: KRvK with KR white and black
@@ -1238,7 +1309,7 @@ void* mapped(TBTable<Type>& e, const Position& pos) {
     fname =
       (e.key == pos.material_key() ? w + 'v' + b : b + 'v' + w) + (Type == WDL ? ".rtbw" : ".rtbz");
 
-    uint8_t* data = TBFile(fname).map(&e.baseAddress, &e.mapping, Type);
+    uint8_t* data = TBFile(*e.paths, fname).map(&e.baseAddress, &e.mapping, Type);
 
     if (data)
         set(e, data);
@@ -1253,7 +1324,8 @@ Ret probe_table(const Position& pos, ProbeState* result, WDLScore wdl = WDLDraw)
     if (pos.count<ALL_PIECES>() == 2)  // KvK
         return Ret(WDLDraw);
 
-    TBTable<Type>* entry = TBTables.get<Type>(pos.material_key());
+    TBTables*      tables = CurrentTables.load(std::memory_order_acquire);
+    TBTable<Type>* entry  = tables ? tables->get<Type>(pos.material_key()) : nullptr;
 
     if (!entry || !mapped(*entry, pos))
         return *result = FAIL, Ret();
@@ -1334,20 +1406,8 @@ WDLScore search(Position& pos, ProbeState* result) {
     return *result = OK, value;
 }
 
-}  // namespace
-
-
-// Called at startup and after every change to
-// "SyzygyPath" UCI option to (re)create the various tables. It is not thread
-// safe, nor it needs to be.
-void Tablebases::init(const std::string& paths) {
-
-    TBTables.clear();
-    MaxCardinality = 0;
-    TBFile::Paths  = paths;
-
-    if (paths.empty())
-        return;
+// Init the index tables shared by all TB files, once per process
+void init_indices() {
 
     // MapB1H1H7[] encodes a square below a1-h8 diagonal to 0..27
     int code = 0;
@@ -1442,51 +1502,300 @@ void Tablebases::init(const std::string& paths) {
             // After a file is traversed, store the cumulated per-file index
             LeadPawnsSize[leadPawnsCnt][f] = idx;
         }
+}
+
+#ifndef _WIN32
+// Listing of the tablebase files of a directory, reused by the following inits as
+// long as the modification time of the directory is unchanged. Guarded by the
+// mutex of Tablebases::init().
+struct DirectoryListing {
+    time_t                   mtime;
+    std::vector<std::string> files;
+};
+
+std::unordered_map<std::string, DirectoryListing> DirectoryListings;
+
+DirectoryListing list_directory(const std::string& dir, time_t mtime) {
+
+    DirectoryListing listing{mtime, {}};
+
+    if (DIR* d = opendir(dir.c_str()))
+    {
+        while (const dirent* entry = readdir(d))
+        {
+            std::string_view name(entry->d_name);
+            std::string_view ext = name.substr(std::max<size_t>(name.size(), 5) - 5);
+
+            if (ext == ".rtbw" || ext == ".rtbz")
+                listing.files.emplace_back(name);
+        }
+        closedir(d);
+    }
+    return listing;
+}
+#endif
+
+// Find the files present in the paths with one listing of each directory, the
+// directories that changed since the previous init are listed in parallel by a
+// pool of threads. This replaces trying to open every possible file in every
+// directory, which is slow on network storage. The files are only opened, and
+// their headers checked, when first mapped.
+void TBTables::index_files() {
+#ifndef _WIN32
+    std::vector<std::string>      dirs, stale;
+    std::vector<DirectoryListing> listings;
+    std::stringstream             ss(paths);
+    std::string                   dir;
+    struct stat                   statbuf;
+
+    while (std::getline(ss, dir, ':'))
+        if (stat(dir.c_str(), &statbuf) == 0 && S_ISDIR(statbuf.st_mode))
+        {
+            dirs.push_back(dir);
+            auto it = DirectoryListings.find(dir);
+            if (it == DirectoryListings.end() || it->second.mtime != statbuf.st_mtime)
+            {
+                stale.push_back(dir);
+                listings.push_back({statbuf.st_mtime, {}});
+            }
+        }
+
+    std::atomic<size_t>      next(0);
+    std::vector<std::thread> pool;
+    size_t threads = std::min<size_t>(stale.size(), std::thread::hardware_concurrency());
+
+    auto worker = [&]() {
+        for (size_t i; (i = next++) < stale.size();)
+            listings[i] = list_directory(stale[i], listings[i].mtime);
+    };
+
+    for (size_t i = 1; i < threads; ++i)
+        pool.emplace_back(worker);
+
+    worker();
+
+    for (auto& th : pool)
+        th.join();
+
+    for (size_t i = 0; i < stale.size(); ++i)
+        DirectoryListings[stale[i]] = std::move(listings[i]);
+
+    for (const auto& d : dirs)
+        for (const auto& f : DirectoryListings[d].files)
+            presentFiles.insert(f);
+
+    indexed = true;
+#endif
+}
+
+// Add entries in TB tables if the corresponding ".rtbw" file exists
+void TBTables::add_all() {
+
+    index_files();
 
-    // Add entries in TB tables if the corresponding ".rtbw" file exists
     for (PieceType p1 = PAWN; p1 < KING; ++p1)
     {
-        TBTables.add({KING, p1, KING});
+        add({KING, p1, KING});
 
         for (PieceType p2 = PAWN; p2 <= p1; ++p2)
         {
-            TBTables.add({KING, p1, p2, KING});
-            TBTables.add({KING, p1, KING, p2});
+            add({KING, p1, p2, KING});
+            add({KING, p1, KING, p2});
 
             for (PieceType p3 = PAWN; p3 < KING; ++p3)
-                TBTables.add({KING, p1, p2, KING, p3});
+                add({KING, p1, p2, KING, p3});
 
             for (PieceType p3 = PAWN; p3 <= p2; ++p3)
             {
-                TBTables.add({KING, p1, p2, p3, KING});
+                add({KING, p1, p2, p3, KING});
 
                 for (PieceType p4 = PAWN; p4 <= p3; ++p4)
                 {
-                    TBTables.add({KING, p1, p2, p3, p4, KING});
+                    add({KING, p1, p2, p3, p4, KING});
 
                     for (PieceType p5 = PAWN; p5 <= p4; ++p5)
-                        TBTables.add({KING, p1, p2, p3, p4, p5, KING});
+                        add({KING, p1, p2, p3, p4, p5, KING});
 
                     for (PieceType p5 = PAWN; p5 < KING; ++p5)
-                        TBTables.add({KING, p1, p2, p3, p4, KING, p5});
+                        add({KING, p1, p2, p3, p4, KING, p5});
                 }
 
                 for (PieceType p4 = PAWN; p4 < KING; ++p4)
                 {
-                    TBTables.add({KING, p1, p2, p3, KING, p4});
+                    add({KING, p1, p2, p3, KING, p4});
 
                     for (PieceType p5 = PAWN; p5 <= p4; ++p5)
-                        TBTables.add({KING, p1, p2, p3, KING, p4, p5});
+                        add({KING, p1, p2, p3, KING, p4, p5});
                 }
             }
 
             for (PieceType p3 = PAWN; p3 <= p1; ++p3)
                 for (PieceType p4 = PAWN; p4 <= (p1 == p3 ? p2 : p3); ++p4)
-                    TBTables.add({KING, p1, p2, KING, p3, p4});
+                    add({KING, p1, p2, KING, p3, p4});
         }
     }
+}
+
+// Piece counts by color and piece type, kings excluded
+using Material = std::array<std::array<uint8_t, KING>, COLOR_NB>;
+
+std::string material_code(const Material& m) {
+
+    std::string code;
+
+    for (Color c : {WHITE, BLACK})
+    {
+        code += c == WHITE ? "K" : "vK";
+        for (PieceType pt = QUEEN; pt >= PAWN; --pt)
+            code += std::string(m[c][pt], PieceToChar[pt]);
+    }
+    return code;
+}
+
+// Map the file and ask the kernel to read all of it in the background, so that
+// the probes of the search do not stall on major page faults. Optionally lock the
+// pages in memory so that they are not evicted later. Each file is warmed once.
+template<TBType Type>
+void warm_up_table(TBTable<Type>* e, const Position& pos, bool pin) {
+
+    if (!e || e->warmed.exchange(true) || !mapped(*e, pos))
+        return;
 
-    TBTables.info();
+#ifndef _WIN32
+    #if defined(MADV_WILLNEED)
+    madvise(e->baseAddress, e->mapping, MADV_WILLNEED);
+    #endif
+    if (pin)
+        mlock(e->baseAddress, e->mapping);  // Best effort, bounded by RLIMIT_MEMLOCK
+#else
+    (void) pin;  // Files are mapped without read-ahead hints on Windows
+#endif
+}
+
+// Warm the tables of every material signature reachable from the root through
+// captures and promotions, nearest to the root first.
+void warm_up_reachable(const Material& root, bool pin) {
+
+    TBTables* tables = CurrentTables.load(std::memory_order_acquire);
+
+    if (!tables)
+        return;
+
+    std::vector<Material>           queue = {root};
+    std::unordered_set<std::string> seen  = {material_code(root)};
+
+    for (size_t i = 0; i < queue.size() && !WarmUp.stop; ++i)
+    {
+        const Material m = queue[i];
+        int            pieces = 2;
+
+        for (Color c : {WHITE, BLACK})
+            for (PieceType pt = PAWN; pt < KING; ++pt)
+                pieces += m[c][pt];
+
+        if (pieces <= tables->max_cardinality())
+        {
+            StateInfo st;
+            Position  pos;
+            Key       key = pos.set(material_code(m), WHITE, &st).material_key();
+
+            warm_up_table(tables->get<WDL>(key), pos, pin);
+            warm_up_table(tables->get<DTZ>(key), pos, pin);
+        }
+
+        auto visit = [&](const Material& next) {
+            if (seen.insert(material_code(next)).second)
+                queue.push_back(next);
+        };
+
+        for (Color c : {WHITE, BLACK})
+            for (PieceType pt = PAWN; pt < KING; ++pt)
+            {
+                if (!m[c][pt])
+                    continue;
+
+                Material next = m;
+                --next[c][pt];
+                visit(next);  // Capture of a piece
+
+                for (PieceType promo = KNIGHT; pt == PAWN && promo <= QUEEN; ++promo)
+                {
+                    next = m;
+                    --next[c][PAWN];
+                    ++next[c][promo];
+                    visit(next);
+                }
+            }
+    }
+}
+
+}  // namespace
+
+
+// Called at startup and after every change to "SyzygyPath" UCI option to
+// (re)create the various tables. Setting the paths in use again is a no-op, so
+// the files stay mapped, and their pages warm, for the life of the process.
+// Thread safe, the tables are shared by all the engines of the process.
+void Tablebases::init(const std::string& paths) {
+
+    static std::mutex     mutex;
+    static std::once_flag indicesInitialized;
+
+    std::scoped_lock<std::mutex> lk(mutex);
+    std::call_once(indicesInitialized, init_indices);
+
+    TBTables* current = CurrentTables.load(std::memory_order_relaxed);
+
+    if (current ? current->paths == paths : paths.empty())
+        return;
+
+    auto tables = std::make_unique<TBTables>(paths);
+
+    if (!paths.empty())
+    {
+        tables->add_all();
+        tables->info();
+    }
+
+    MaxCardinality = tables->max_cardinality();
+    CurrentTables.store(tables.release(), std::memory_order_release);
+    WDLCache.clear();
+    DTZCache.clear();
+
+    if (current)
+        RetiredTables.emplace_back(current);
+}
+
+// Start warming up the tables reachable from the given position in the background,
+// see warm_up_reachable(). Does nothing while a previous warm-up is still running.
+// If wait is set, the warm-up runs in the calling thread instead.
+void Tablebases::warm_up(const Position& pos, bool pin, bool wait) {
+
+    static std::mutex mutex;
+
+    std::scoped_lock<std::mutex> lk(mutex);
+
+    if (!MaxCardinality || WarmUp.running.exchange(true))
+        return;
+
+    Material m{};
+    for (Color c : {WHITE, BLACK})
+        for (PieceType pt = PAWN; pt < KING; ++pt)
+            m[c][pt] = popcount(pos.pieces(c, pt));
+
+    auto job = [m, pin]() {
+        warm_up_reachable(m, pin);
+        WarmUp.running = false;
+    };
+
+    // The previous warm-up is done, reap its thread before starting a new one
+    if (WarmUp.thread.joinable())
+        WarmUp.thread.join();
+
+    if (wait)
+        job();
+    else
+        WarmUp.thread = std::thread(job);
 }
 
 // Probe the WDL table for a particular position.
@@ -1497,39 +1806,26 @@ void Tablebases::init(const std::string& paths) {
 //  0 : draw
 //  1 : win, but draw under 50-move rule
 //  2 : win
-WDLScore Tablebases::probe_wdl(Position& pos, ProbeState* result) {
+// If useCache is set, the result is looked up in and stored to the probe cache.
+WDLScore Tablebases::probe_wdl(Position& pos, ProbeState* result, bool useCache) {
 
-    *result = OK;
-    return search<false>(pos, result);
+    int value;
+    if (useCache && WDLCache.probe(pos.key(), &value, result))
+        return WDLScore(value);
+
+    *result      = OK;
+    WDLScore wdl = search<false>(pos, result);
+
+    if (useCache && *result != FAIL)
+        WDLCache.store(pos.key(), wdl, *result);
+
+    return wdl;
 }
 
-// Probe the DTZ table for a particular position.
-// If *result != FAIL, the probe was successful.
-// The return value is from the point of view of the side to move:
-//         n < -100 : loss, but draw under 50-move rule
-// -100 <= n < -1   : loss in n ply (assuming 50-move counter == 0)
-//        -1        : loss, the side to move is mated
-//         0        : draw
-//     1 < n <= 100 : win in n ply (assuming 50-move counter == 0)
-//   100 < n        : win, but draw under 50-move rule
-//
-// The return value n can be off by 1: a return value -n can mean a loss
-// in n+1 ply and a return value +n can mean a win in n+1 ply. This
-// cannot happen for tables with positions exactly on the "edge" of
-// the 50-move rule.
-//
-// This implies that if dtz > 0 is returned, the position is certainly
-// a win if dtz + 50-move-counter <= 99. Care must be taken that the engine
-// picks moves that preserve dtz + 50-move-counter <= 99.
-//
-// If n = 100 immediately after a capture or pawn move, then the position
-// is also certainly a win, and during the whole phase until the next
-// capture or pawn move, the inequality to be preserved is
-// dtz + 50-move-counter <= 100.
-//
-// In short, if a move is available resulting in dtz + 50-move-counter <= 99,
-// then do not accept moves leading to dtz + 50-move-counter == 100.
-int Tablebases::probe_dtz(Position& pos, ProbeState* result) {
+namespace {
+
+// Probe the DTZ table without going through the probe cache, see probe_dtz()
+int probe_dtz_table(Position& pos, ProbeState* result, bool useCache) {
 
     *result      = OK;
     WDLScore wdl = search<true>(pos, result);
@@ -1565,7 +1861,7 @@ int Tablebases::probe_dtz(Position& pos, ProbeState* result) {
         // otherwise we will get the dtz of the next move sequence. Search the
         // position after the move to get the score sign (because even in a
         // winning position we could make a losing capture or go for a draw).
-        dtz = zeroing ? -dtz_before_zeroing(search<false>(pos, result)) : -probe_dtz(pos, result);
+        dtz = zeroing ? -dtz_before_zeroing(search<false>(pos, result)) : -probe_dtz(pos, result, useCache);
 
         // If the move mates, force minDTZ to 1
         if (dtz == 1 && pos.checkers() && MoveList<LEGAL>(pos).size() == 0)
@@ -1590,6 +1886,48 @@ int Tablebases::probe_dtz(Position& pos, ProbeState* result) {
     return minDTZ == 0xFFFF ? -1 : minDTZ;
 }
 
+}  // namespace
+
+// Probe the DTZ table for a particular position.
+// If *result != FAIL, the probe was successful.
+// The return value is from the point of view of the side to move:
+//         n < -100 : loss, but draw under 50-move rule
+// -100 <= n < -1   : loss in n ply (assuming 50-move counter == 0)
+//        -1        : loss, the side to move is mated
+//         0        : draw
+//     1 < n <= 100 : win in n ply (assuming 50-move counter == 0)
+//   100 < n        : win, but draw under 50-move rule
+//
+// The return value n can be off by 1: a return value -n can mean a loss
+// in n+1 ply and a return value +n can mean a win in n+1 ply. This
+// cannot happen for tables with positions exactly on the "edge" of
+// the 50-move rule.
+//
+// This implies that if dtz > 0 is returned, the position is certainly
+// a win if dtz + 50-move-counter <= 99. Care must be taken that the engine
+// picks moves that preserve dtz + 50-move-counter <= 99.
+//
+// If n = 100 immediately after a capture or pawn move, then the position
+// is also certainly a win, and during the whole phase until the next
+// capture or pawn move, the inequality to be preserved is
+// dtz + 50-move-counter <= 100.
+//
+// In short, if a move is available resulting in dtz + 50-move-counter <= 99,
+// then do not accept moves leading to dtz + 50-move-counter == 100.
+int Tablebases::probe_dtz(Position& pos, ProbeState* result, bool useCache) {
+
+    int value;
+    if (useCache && DTZCache.probe(pos.key(), &value, result))
+        return value;
+
+    value = probe_dtz_table(pos, result, useCache);
+
+    if (useCache && *result != FAIL)
+        DTZCache.store(pos.key(), value, *result);
+
+    return value;
+}
+
 
 // Use the DTZ tables to rank root moves.
 //
@@ -1598,6 +1936,7 @@ bool Tablebases::root_probe(Position&                    pos,
                             Search::RootMoves&           rootMoves,
                             bool                         rule50,
                             bool                         rankDTZ,
+                            bool                         useCache,
                             const std::function<bool()>& time_abort) {
 
     ProbeState result = OK;
@@ -1620,7 +1959,7 @@ bool Tablebases::root_probe(Position&                    pos,
         if (pos.rule50_count() == 0)
         {
             // In case of a zeroing move, dtz is one of -101/-1/0/1/101
-            WDLScore wdl = -probe_wdl(pos, &result);
+            WDLScore wdl = -probe_wdl(pos, &result, useCache);
             dtz          = dtz_before_zeroing(wdl);
         }
         else if ((rule50 && pos.is_draw(1)) || pos.is_repetition(1))
@@ -1633,7 +1972,7 @@ bool Tablebases::root_probe(Position&                    pos,
         else
         {
             // Otherwise, take dtz for the new position and correct by 1 ply
-            dtz = -probe_dtz(pos, &result);
+            dtz = -probe_dtz(pos, &result, useCache);
             dtz = dtz > 0 ? dtz + 1 : dtz < 0 ? dtz - 1 : dtz;
         }
 
@@ -1674,7 +2013,10 @@ bool Tablebases::root_probe(Position&                    pos,
 // This is a fallback for the case that some or all DTZ tables are missing.
 //
 // A return value false indicates that not all probes were successful.
-bool Tablebases::root_probe_wdl(Position& pos, Search::RootMoves& rootMoves, bool rule50) {
+bool Tablebases::root_probe_wdl(Position&          pos,
+                                Search::RootMoves& rootMoves,
+                                bool               rule50,
+                                bool               useCache) {
 
     static const int WDL_to_rank[] = {-MAX_DTZ, -MAX_DTZ + 101, 0, MAX_DTZ - 101, MAX_DTZ};
 
@@ -1691,7 +2033,7 @@ bool Tablebases::root_probe_wdl(Position& pos, Search::RootMoves& rootMoves, boo
         if (pos.is_draw(1))
             wdl = WDLDraw;
         else
-            wdl = -probe_wdl(pos, &result);
+            wdl = -probe_wdl(pos, &result, useCache);
 
         pos.undo_move(m.pv[0]);
 
@@ -1718,10 +2060,11 @@ Config Tablebases::rank_root_moves(const OptionsMap&            options,
     if (rootMoves.empty())
         return config;
 
-    config.rootInTB    = false;
-    config.useRule50   = bool(options["Syzygy50MoveRule"]);
-    config.probeDepth  = int(options["SyzygyProbeDepth"]);
-    config.cardinality = int(options["SyzygyProbeLimit"]);
+    config.rootInTB      = false;
+    config.useRule50     = bool(options["Syzygy50MoveRule"]);
+    config.probeDepth    = int(options["SyzygyProbeDepth"]);
+    config.cardinality   = int(options["SyzygyProbeLimit"]);
+    config.useProbeCache = bool(options["SyzygyProbeCache"]);
 
     bool dtz_available = true;
 
@@ -1736,14 +2079,15 @@ Config Tablebases::rank_root_moves(const OptionsMap&            options,
     if (config.cardinality >= popcount(pos.pieces()) && !pos.can_castle(ANY_CASTLING))
     {
         // Rank moves using DTZ tables, bail out if time_abort flags zeitnot
-        config.rootInTB =
-          root_probe(pos, rootMoves, options["Syzygy50MoveRule"], rankDTZ, time_abort);
+        config.rootInTB = root_probe(pos, rootMoves, options["Syzygy50MoveRule"], rankDTZ,
+                                     config.useProbeCache, time_abort);
 
         if (!config.rootInTB && !time_abort())
         {
             // DTZ tables are missing; try to rank moves using WDL tables
             dtz_available   = false;
-            config.rootInTB = root_probe_wdl(pos, rootMoves, options["Syzygy50MoveRule"]);
+            config.rootInTB = root_probe_wdl(pos, rootMoves, options["Syzygy50MoveRule"],
+                                             config.useProbeCache);
         }
     }
 
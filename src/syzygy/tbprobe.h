@@ -39,10 +39,11 @@ using RootMoves = std::vector<RootMove>;
 namespace Stockfish::Tablebases {
 
 struct Config {
-    int   cardinality = 0;
-    bool  rootInTB    = false;
-    bool  useRule50   = false;
-    Depth probeDepth  = 0;
+    int   cardinality   = 0;
+    bool  rootInTB      = false;
+    bool  useRule50     = false;
+    Depth probeDepth    = 0;
+    bool  useProbeCache = false;  // Cache the results of probe_wdl() and probe_dtz()
 };
 
 enum WDLScore {
@@ -65,14 +66,16 @@ extern int MaxCardinality;
 
 
 void     init(const std::string& paths);
-WDLScore probe_wdl(Position& pos, ProbeState* result);
-int      probe_dtz(Position& pos, ProbeState* result);
+void     warm_up(const Position& pos, bool pin, bool wait = false);
+WDLScore probe_wdl(Position& pos, ProbeState* result, bool useCache = false);
+int      probe_dtz(Position& pos, ProbeState* result, bool useCache = false);
 bool     root_probe(Position&                    pos,
                     Search::RootMoves&           rootMoves,
                     bool                         rule50,
                     bool                         rankDTZ,
+                    bool                         useCache,
                     const std::function<bool()>& time_abort);
-bool     root_probe_wdl(Position& pos, Search::RootMoves& rootMoves, bool rule50);
+bool root_probe_wdl(Position& pos, Search::RootMoves& rootMoves, bool rule50, bool useCache);
 Config   rank_root_moves(
     const OptionsMap&            options,
     Position&                    pos,
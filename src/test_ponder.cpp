@@ -95,7 +95,7 @@ private:
                     Position temp_pos;
                     StateInfo si;
                     temp_pos.set(StartFEN, false, &si);
-                    StateListPtr states(new std::deque<StateInfo>(1));
+                    StateListPtr states = make_state_list();
 
                     // Replay confirmed moves
                     // agent.game_moves contains: OppMove1, MyMove1, OppMove2, MyMove2...
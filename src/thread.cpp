@@ -27,6 +27,13 @@
 #include <string>
 #include <unordered_map>
 #include <utility>
+#include <vector>
+
+#if defined(__linux__) && !defined(__ANDROID__)
+    #include <fcntl.h>
+    #include <sys/file.h>
+    #include <unistd.h>
+#endif
 
 #include "memory.h"
 #include "movegen.h"
@@ -152,6 +159,54 @@ Search::SearchManager* ThreadPool::main_manager() { return main_thread()->worker
 uint64_t ThreadPool::nodes_searched() const { return accumulate(&Search::Worker::nodes); }
 uint64_t ThreadPool::tb_hits() const { return accumulate(&Search::Worker::tbHits); }
 
+// Sums the eval cache counters of all threads. Only meaningful while the
+// threads are idle, the counters are plain per-thread integers.
+Eval::NNUE::EvalCache::Stats ThreadPool::eval_cache_stats() const {
+
+    Eval::NNUE::EvalCache::Stats sum;
+    for (auto&& th : threads)
+        if (const auto& cache = th->worker->evalCache)
+        {
+            sum.probes += cache->stats.probes;
+            sum.hits += cache->stats.hits;
+        }
+    return sum;
+}
+
+// Sums the threat accumulator counters of all threads, same caveat as above
+ThreatStats ThreadPool::threat_stats() const {
+
+    ThreatStats sum;
+    for (auto&& th : threads)
+    {
+        const ThreatStats& s = th->worker->refreshTable.big.threatStats;
+        sum.updates += s.updates;
+        sum.updateFeatures += s.updateFeatures;
+        sum.refreshes += s.refreshes;
+        sum.refreshFeatures += s.refreshFeatures;
+        sum.activeFeatures += s.activeFeatures;
+    }
+    return sum;
+}
+
+// Sums the transposition table counters of all threads, same caveat as above
+TTCounters ThreadPool::tt_counters() const {
+
+    TTCounters sum;
+    for (auto&& th : threads)
+    {
+        const TTCounters& c = th->worker->ttCounters;
+        sum.probes += c.probes;
+        sum.hits += c.hits;
+        sum.frontHits += c.frontHits;
+        sum.writes += c.writes;
+        sum.replaced += c.replaced;
+        sum.replacedCurrent += c.replacedCurrent;
+        sum.missOccupancy += c.missOccupancy;
+    }
+    return sum;
+}
+
 // Creates/destroys threads to match the requested number.
 // Created and launched threads will immediately go to sleep in idle_loop.
 // Upon resizing, threads are recreated to allow for binding if necessary.
@@ -168,6 +223,8 @@ void ThreadPool::set(const NumaConfig&                           numaConfig,
         boundThreadToNumaNode.clear();
     }
 
+    release_cores();
+
     const size_t requested = sharedState.options["Threads"];
 
     if (requested > 0)  // create new thread(s)
@@ -190,14 +247,30 @@ void ThreadPool::set(const NumaConfig&                           numaConfig,
             return true;
         }();
 
+        // A placement on the physical cores pins each thread to a processor, and
+        // thus to the NUMA node of that processor, whatever the NUMA policy.
+        const Option&               placement = sharedState.options["ThreadPlacement"];
+        const std::vector<CpuIndex> threadCpus =
+          placement == "cores" || placement == "siblings"
+            ? place_threads(numaConfig, requested, placement == "cores", sharedState.options)
+            : std::vector<CpuIndex>{};
+
         boundThreadToNumaNode = doBindThreads
                                 ? numaConfig.distribute_threads_among_numa_nodes(requested)
                                 : std::vector<NumaIndex>{};
 
+        if (!threadCpus.empty())
+        {
+            boundThreadToNumaNode.clear();
+            for (CpuIndex c : threadCpus)
+                boundThreadToNumaNode.push_back(numaConfig.nodeByCpu.at(c));
+        }
+
         while (threads.size() < requested)
         {
             const size_t    threadId = threads.size();
-            const NumaIndex numaId   = doBindThreads ? boundThreadToNumaNode[threadId] : 0;
+            const NumaIndex numaId =
+              boundThreadToNumaNode.empty() ? 0 : boundThreadToNumaNode[threadId];
             auto            manager  = threadId == 0 ? std::unique_ptr<Search::ISearchManager>(
                                              std::make_unique<Search::SearchManager>(updateContext))
                                                      : std::make_unique<Search::NullSearchManager>();
@@ -206,8 +279,11 @@ void ThreadPool::set(const NumaConfig&                           numaConfig,
             // from the same NUMA node, because in case of NUMA replicated memory
             // accesses we don't want to trash cache in case the threads get scheduled
             // on the same NUMA node.
-            auto binder = doBindThreads ? OptionalThreadToNumaNodeBinder(numaConfig, numaId)
-                                        : OptionalThreadToNumaNodeBinder(numaId);
+            OptionalThreadToNumaNodeBinder binder(numaId);
+            if (!threadCpus.empty())
+                binder = OptionalThreadToNumaNodeBinder(numaConfig, numaId, threadCpus[threadId]);
+            else if (doBindThreads)
+                binder = OptionalThreadToNumaNodeBinder(numaConfig, numaId);
 
             threads.emplace_back(
               std::make_unique<Thread>(sharedState, std::move(manager), threadId, binder));
@@ -219,6 +295,121 @@ void ThreadPool::set(const NumaConfig&                           numaConfig,
     }
 }
 
+// Returns the processor of each thread with the "cores" and "siblings" thread
+// placements. The physical cores are taken alternately from each NUMA node. The
+// last ReservedCores of them are left free for the other threads of the process,
+// such as the gRPC I/O threads, and with ExclusiveCores the cores claimed by other
+// processes are skipped, as long as there are free ones. "cores" places one thread
+// per core before using their SMT siblings, "siblings" fills each core in turn.
+std::vector<CpuIndex> ThreadPool::place_threads(const NumaConfig& numaConfig,
+                                                size_t            numThreads,
+                                                bool              spread,
+                                                const OptionsMap& options) {
+
+    std::vector<std::vector<std::vector<CpuIndex>>> coresByNode(numaConfig.num_numa_nodes());
+    for (auto& core : numaConfig.physical_cores())
+        coresByNode[numaConfig.nodeByCpu.at(core[0])].emplace_back(std::move(core));
+
+    std::vector<std::vector<CpuIndex>> cores;
+    for (size_t i = 0;; ++i)
+    {
+        size_t added = 0;
+        for (auto& nodeCores : coresByNode)
+            if (i < nodeCores.size())
+            {
+                cores.emplace_back(std::move(nodeCores[i]));
+                ++added;
+            }
+
+        if (!added)
+            break;
+    }
+
+    const size_t reserved = std::min<size_t>(int(options["ReservedCores"]), cores.size() - 1);
+    cores.resize(cores.size() - reserved);
+
+    if (options["ExclusiveCores"])
+    {
+        std::vector<std::vector<CpuIndex>> claimed;
+        size_t                             capacity = 0;
+
+        for (auto& core : cores)
+            if (capacity < numThreads && claim_core(core[0], options["CoreLockDir"]))
+            {
+                capacity += spread ? 1 : core.size();
+                claimed.emplace_back(std::move(core));
+            }
+
+        // All the cores are claimed by other processes: share them
+        if (!claimed.empty())
+            cores = std::move(claimed);
+    }
+
+    std::vector<CpuIndex> cpus;
+    if (spread)
+    {
+        for (size_t sibling = 0, added = 1; added; ++sibling)
+        {
+            added = 0;
+            for (const auto& core : cores)
+                if (sibling < core.size())
+                {
+                    cpus.push_back(core[sibling]);
+                    ++added;
+                }
+        }
+    }
+    else
+        for (const auto& core : cores)
+            cpus.insert(cpus.end(), core.begin(), core.end());
+
+    // More threads than processors: start over
+    std::vector<CpuIndex> threadCpus;
+    for (size_t i = 0; i < numThreads; ++i)
+        threadCpus.push_back(cpus[i % cpus.size()]);
+
+    return threadCpus;
+}
+
+// Claims a physical core for this process with a lock on a file named after its
+// first processor in the given directory, so that agents on the same host do not
+// share cores. Agents in different containers need a directory shared between
+// them. The lock is released when the file is closed, also when the process dies.
+bool ThreadPool::claim_core([[maybe_unused]] CpuIndex           firstCpu,
+                            [[maybe_unused]] const std::string& lockDir) {
+
+#if defined(__linux__) && !defined(__ANDROID__)
+
+    // Not through a symbolic link, the directory may be writable by anyone
+    std::string path = lockDir + "/stockfish-core-" + std::to_string(firstCpu) + ".lock";
+    int         fd   = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC | O_NOFOLLOW, 0666);
+
+    // Without a lock file there is no way to coordinate, use the core anyway
+    if (fd < 0)
+        return true;
+
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    coreLocks.push_back(fd);
+
+#endif
+
+    return true;
+}
+
+void ThreadPool::release_cores() {
+
+#if defined(__linux__) && !defined(__ANDROID__)
+    for (int fd : coreLocks)
+        close(fd);
+#endif
+
+    coreLocks.clear();
+}
 
 // Sets threadPool data to initial values
 void ThreadPool::clear() {
@@ -228,6 +419,18 @@ void ThreadPool::clear() {
     for (auto&& th : threads)
         th->clear_worker();
 
+    // Shared histories are cleared once per NUMA node, by a thread of that node
+    std::vector<SharedHistories*> cleared;
+    for (auto&& th : threads)
+    {
+        SharedHistories* shared = th->worker->sharedHistories;
+        if (shared && std::find(cleared.begin(), cleared.end(), shared) == cleared.end())
+        {
+            cleared.push_back(shared);
+            th->run_custom_job([shared]() { shared->clear(); });
+        }
+    }
+
     for (auto&& th : threads)
         th->wait_for_search_finished();
 
@@ -268,6 +471,11 @@ void ThreadPool::start_thinking(const OptionsMap&  options,
 
     increaseDepth = true;
 
+    detQuantum      = size_t(options["DeterministicQuantum"]);
+    detParticipants = threads.size();
+    detArrived      = 0;
+    detStopRequest = detAbortRequest = false;
+
     Search::RootMoves rootMoves;
     const auto        legalmoves = MoveList<LEGAL>(pos);
 
@@ -283,6 +491,11 @@ void ThreadPool::start_thinking(const OptionsMap&  options,
         for (const auto& m : legalmoves)
             rootMoves.emplace_back(m);
 
+    // Start reading the tables the search is about to probe before it needs them
+    if (bool(options["SyzygyWarmup"])
+        && pos.count<ALL_PIECES>() <= Tablebases::MaxCardinality + 2)
+        Tablebases::warm_up(pos, bool(options["SyzygyPin"]));
+
     Tablebases::Config tbConfig = Tablebases::rank_root_moves(options, pos, rootMoves);
 
     // After ownership transfer 'states' becomes empty, so if we stop the search
@@ -306,18 +519,95 @@ void ThreadPool::start_thinking(const OptionsMap&  options,
               th->worker->bestMoveChanges          = 0;
             th->worker->rootDepth = th->worker->completedDepth = 0;
             th->worker->rootMoves                              = rootMoves;
+            th->worker->ttCounters                             = {};
             th->worker->rootPos.set(pos.fen(), pos.is_chess960(), &th->worker->rootState);
             th->worker->rootState = setupStates->back();
             th->worker->tbConfig  = tbConfig;
+
+            if (!detQuantum)
+                th->worker->ttLog.reset();
+            else if (!th->worker->ttLog)
+                th->worker->ttLog = std::make_unique<TTLog>();
+            th->worker->nextSync = detQuantum;
         });
     }
 
     for (auto&& th : threads)
         th->wait_for_search_finished();
 
+    publish_best_move(rootMoves.empty() ? Move::none() : rootMoves[0].pv[0], Move::none());
+
     main_thread()->start_searching();
 }
 
+// Raises the stop, at the next synchronization point in the deterministic mode
+void ThreadPool::request_stop(bool aborted) {
+
+    if (!detQuantum)
+    {
+        if (aborted)
+            abortedSearch = true;
+        stop = true;
+        return;
+    }
+
+    std::lock_guard<std::mutex> lk(detMutex);
+    detStopRequest = true;
+    detAbortRequest |= aborted;
+}
+
+// Called by each thread of a deterministic search after every quantum of nodes,
+// and once when leaving the search. The last thread to arrive runs the serial
+// section, the others wait for it unless leaving. What the threads see of the
+// table and of the stop between two synchronization points is therefore the
+// same in every run, whatever the timing of the threads.
+void ThreadPool::synchronize(Search::Worker& worker, bool leaving) {
+
+    std::unique_lock<std::mutex> lk(detMutex);
+    bool                         stopping = false;
+
+    if (leaving)
+    {
+        --detParticipants;
+
+        // A main thread done with its iterations stops the others, and waits for
+        // the stop to be raised, unless the search goes on until a "stop" or
+        // "ponderhit" from the GUI.
+        if (worker.is_mainthread() && !main_manager()->ponder && !worker.limits.infinite)
+            detStopRequest = stopping = true;
+    }
+    else
+        ++detArrived;
+
+    if (detArrived == detParticipants)
+    {
+        for (auto&& th : threads)
+            th->worker->ttLog->apply();
+
+        const Search::Worker& main = *main_thread()->worker;
+        if (worker.limits.nodes && main.completedDepth >= 1
+            && nodes_searched() >= worker.limits.nodes)
+            detStopRequest = detAbortRequest = true;
+
+        if (detStopRequest)
+        {
+            abortedSearch = abortedSearch || detAbortRequest;
+            stop          = true;
+        }
+
+        detArrived = 0;
+        ++detPhase;
+        detCv.notify_all();
+    }
+    else if (!leaving || stopping)
+    {
+        const uint64_t phase = detPhase;
+        detCv.wait(lk, [&] { return detPhase != phase; });
+    }
+
+    worker.nextSync = worker.nodes.load(std::memory_order_relaxed) + detQuantum;
+}
+
 Thread* ThreadPool::get_best_thread() const {
 
     Thread* bestThread = threads.front().get();
@@ -26,6 +26,8 @@
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <utility>
 #include <vector>
 
 #include "memory.h"
@@ -40,6 +42,9 @@ namespace Stockfish {
 class OptionsMap;
 using Value = int;
 
+using ThreatStats =
+  Eval::NNUE::AccumulatorCaches::Cache<Eval::NNUE::TransformedFeatureDimensionsBig>::ThreatStats;
+
 // Sometimes we don't want to actually bind the threads, but the recipient still
 // needs to think it runs on *some* NUMA node, such that it can access structures
 // that rely on NUMA node knowledge. This class encapsulates this optional process
@@ -54,16 +59,25 @@ class OptionalThreadToNumaNodeBinder {
         numaConfig(&cfg),
         numaId(n) {}
 
+    // Binds to a single processor, which belongs to the NUMA node n
+    OptionalThreadToNumaNodeBinder(const NumaConfig& cfg, NumaIndex n, CpuIndex c) :
+        numaConfig(&cfg),
+        numaId(n),
+        cpu(c) {}
+
     NumaReplicatedAccessToken operator()() const {
-        if (numaConfig != nullptr)
+        if (numaConfig != nullptr && cpu.has_value())
+            return numaConfig->bind_current_thread_to_cpu(*cpu);
+        else if (numaConfig != nullptr)
             return numaConfig->bind_current_thread_to_numa_node(numaId);
         else
             return NumaReplicatedAccessToken(numaId);
     }
 
    private:
-    const NumaConfig* numaConfig;
-    NumaIndex         numaId;
+    const NumaConfig*       numaConfig;
+    NumaIndex               numaId;
+    std::optional<CpuIndex> cpu;
 };
 
 // Abstraction of a thread. It contains a pointer to the worker and a native thread.
@@ -122,6 +136,8 @@ class ThreadPool {
 
             threads.clear();
         }
+
+        release_cores();
     }
 
     ThreadPool(const ThreadPool&) = delete;
@@ -139,18 +155,42 @@ class ThreadPool {
                Search::SharedState,
                const Search::SearchManager::UpdateContext&);
 
-    Search::SearchManager* main_manager();
-    Thread*                main_thread() const { return threads.front().get(); }
-    uint64_t               nodes_searched() const;
-    uint64_t               tb_hits() const;
-    Thread*                get_best_thread() const;
-    void                   start_searching();
-    void                   wait_for_search_finished() const;
+    Search::SearchManager*       main_manager();
+    Thread*                      main_thread() const { return threads.front().get(); }
+    uint64_t                     nodes_searched() const;
+    uint64_t                     tb_hits() const;
+    Eval::NNUE::EvalCache::Stats eval_cache_stats() const;
+    ThreatStats                  threat_stats() const;
+    TTCounters                   tt_counters() const;
+    Thread*                      get_best_thread() const;
+    void                         start_searching();
+    void                         wait_for_search_finished() const;
 
     std::vector<size_t> get_bound_thread_count_by_numa_node() const;
 
+    // The best move of the main thread so far and its ponder move, published at
+    // the start of the search and after each iteration, for a watchdog that has
+    // to play a move when the search does not return in time.
+    void publish_best_move(Move best, Move ponder) {
+        bestMoveSoFar.store(best.raw() | std::uint32_t(ponder.raw()) << 16,
+                            std::memory_order_release);
+    }
+
+    std::pair<Move, Move> best_move_so_far() const {
+        std::uint32_t moves = bestMoveSoFar.load(std::memory_order_acquire);
+        return {Move(std::uint16_t(moves)), Move(std::uint16_t(moves >> 16))};
+    }
+
     void ensure_network_replicated();
 
+    // Deterministic search mode. With a quantum, the threads meet each time they
+    // have searched that many more nodes, and the last one to arrive applies the
+    // held back TT writes of all of them and raises the requested stops. Zero when
+    // disabled, then request_stop() raises the stop at once.
+    size_t deterministic_quantum() const { return detQuantum; }
+    void   synchronize(Search::Worker& worker, bool leaving);
+    void   request_stop(bool aborted = false);
+
     std::atomic_bool stop, abortedSearch, increaseDepth;
 
     auto cbegin() const noexcept { return threads.cbegin(); }
@@ -164,6 +204,18 @@ class ThreadPool {
     StateListPtr                         setupStates;
     std::vector<std::unique_ptr<Thread>> threads;
     std::vector<NumaIndex>               boundThreadToNumaNode;
+    std::vector<int>                     coreLocks;  // Held with ExclusiveCores
+    std::atomic<std::uint32_t>           bestMoveSoFar{0};
+
+    size_t                  detQuantum = 0, detParticipants = 0, detArrived = 0;
+    uint64_t                detPhase       = 0;
+    bool                    detStopRequest = false, detAbortRequest = false;
+    std::mutex              detMutex;
+    std::condition_variable detCv;
+
+    std::vector<CpuIndex> place_threads(const NumaConfig&, size_t, bool, const OptionsMap&);
+    bool                  claim_core(CpuIndex firstCpu, const std::string& lockDir);
+    void                  release_cores();
 
     uint64_t accumulate(std::atomic<uint64_t> Search::Worker::* member) const {
 
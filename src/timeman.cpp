@@ -22,17 +22,124 @@
 #include <cassert>
 #include <cmath>
 #include <cstdint>
+#include <fstream>
+#include <sstream>
 
 #include "search.h"
 #include "option.h"
 
 namespace Stockfish {
 
+namespace {
+
+template<std::size_t N>
+int bucket(const std::array<double, N>& bounds, double value) {
+    return int(std::upper_bound(bounds.begin(), bounds.end(), value) - bounds.begin());
+}
+
+constexpr int TimeControlBuckets = int(TimeModel::TimeControls.size()) + 1;
+constexpr int PlyBuckets         = int(TimeModel::Plies.size()) + 1;
+constexpr int ClockRatioBuckets  = int(TimeModel::ClockRatios.size()) + 1;
+constexpr int ChangeBuckets      = int(TimeModel::Changes.size()) + 1;
+constexpr int EffortBuckets      = int(TimeModel::Efforts.size()) + 1;
+
+static_assert(TimeModel::OptimumCells == TimeControlBuckets * PlyBuckets * ClockRatioBuckets);
+static_assert(TimeModel::IterationCells == ChangeBuckets * EffortBuckets);
+
+}  // namespace
+
+int TimeModel::optimum_cell(TimePoint gameTime, int ply, TimePoint ours, TimePoint theirs) {
+
+    // Without the opponent's clock, take the clocks as even
+    int ratio = theirs > 0 ? bucket(ClockRatios, double(ours) / theirs) : bucket(ClockRatios, 1.0);
+
+    return (bucket(TimeControls, gameTime / 1000.0) * PlyBuckets + bucket(Plies, ply))
+           * ClockRatioBuckets
+         + ratio;
+}
+
+int TimeModel::iteration_cell(double bestMoveChanges, double effort) {
+    return bucket(Changes, bestMoveChanges) * EffortBuckets + bucket(Efforts, effort);
+}
+
+void TimeModel::reset() {
+    optimum.fill(1.0);
+    iteration.fill(1.0);
+}
+
+// The table is a text file of lines "optimum <time control> <ply> <clock ratio>
+// <scale>" and "iteration <best move changes> <effort> <scale>", with the bucket
+// indices of the keys. Cells without a line keep a scale of 1.
+bool TimeModel::load(const std::string& path) {
+
+    reset();
+
+    std::ifstream file(path);
+    if (!file)
+        return false;
+
+    for (std::string line; std::getline(file, line);)
+    {
+        std::istringstream is(line);
+        std::string        table;
+        int                a, b, c;
+        double             scale = 0;
+        double*            cell  = nullptr;
+
+        if (!(is >> table) || table[0] == '#')
+            continue;
+
+        if (table == "optimum" && is >> a >> b >> c >> scale && a >= 0 && a < TimeControlBuckets
+            && b >= 0 && b < PlyBuckets && c >= 0 && c < ClockRatioBuckets)
+            cell = &optimum[(a * PlyBuckets + b) * ClockRatioBuckets + c];
+
+        else if (table == "iteration" && is >> a >> b >> scale && a >= 0 && a < ChangeBuckets
+                 && b >= 0 && b < EffortBuckets)
+            cell = &iteration[a * EffortBuckets + b];
+
+        if (!cell || !(scale > 0.0 && scale <= 10.0))
+        {
+            reset();
+            return false;
+        }
+
+        *cell = scale;
+    }
+
+    return true;
+}
+
+bool TimeModel::save(const std::string& path) const {
+
+    std::ofstream file(path);
+
+    file << "# Time model: multipliers of the optimum time of a move, by time control,\n"
+         << "# ply and clock ratio, and of the time allowed after each iteration, by\n"
+         << "# best move changes and effort. See TimeModel in timeman.h for the buckets.\n";
+
+    for (int i = 0; i < OptimumCells; ++i)
+        file << "optimum " << i / (PlyBuckets * ClockRatioBuckets) << ' '
+             << i / ClockRatioBuckets % PlyBuckets << ' ' << i % ClockRatioBuckets << ' '
+             << optimum[i] << '\n';
+
+    for (int i = 0; i < IterationCells; ++i)
+        file << "iteration " << i / EffortBuckets << ' ' << i % EffortBuckets << ' '
+             << iteration[i] << '\n';
+
+    return bool(file);
+}
+
 TimePoint TimeManagement::optimum() const { return optimumTime; }
 TimePoint TimeManagement::maximum() const { return maximumTime; }
 
+double TimeManagement::iteration_scale(double bestMoveChanges, double effort) {
+    iterationCell = TimeModel::iteration_cell(bestMoveChanges, effort);
+    return model ? model->iteration[iterationCell] : 1.0;
+}
+
 void TimeManagement::clear() {
     availableNodes = -1;  // When in 'nodes as time' mode
+    gameTime       = 0;
 }
 
 void TimeManagement::advance_nodes_time(std::int64_t nodes) {
@@ -48,17 +155,26 @@ void TimeManagement::init(Search::LimitsType& limits,
                           Color               us,
                           int                 ply,
                           const OptionsMap&   options,
+                          const TimeModel&    timeModel,
                           double&             originalTimeAdjust) {
     TimePoint npmsec = TimePoint(options["nodestime"]);
 
     // If we have no time, we don't need to fully initialize TM.
     // startTime is used by movetime and useNodesTime is used in elapsed calls.
-    startTime    = limits.startTime;
-    useNodesTime = npmsec != 0;
+    startTime     = limits.startTime;
+    useNodesTime  = npmsec != 0;
+    model         = &timeModel;
+    optimumCell   = -1;
+    iterationCell = -1;
 
     if (limits.time[us] == 0)
         return;
 
+    // Keys of the time model, in milliseconds also in 'nodes as time' mode
+    const TimePoint ourTime = limits.time[us], theirTime = limits.time[~us];
+    if (gameTime == 0)
+        gameTime = ourTime + 40 * limits.inc[us];
+
     TimePoint moveOverhead = TimePoint(options["Move Overhead"]);
 
     // optScale is a percentage of available time to use for the current move.
@@ -133,6 +249,9 @@ void TimeManagement::init(Search::LimitsType& limits,
     maximumTime =
       TimePoint(std::min(0.825179 * limits.time[us] - moveOverhead, maxScale * optimumTime)) - 10;
 
+    optimumCell = TimeModel::optimum_cell(gameTime, ply, ourTime, theirTime);
+    optimumTime = TimePoint(optimumTime * timeModel.optimum[optimumCell]);
+
     if (options["Ponder"])
         optimumTime += optimumTime / 4;
 }
@@ -19,7 +19,9 @@
 #ifndef TIMEMAN_H_INCLUDED
 #define TIMEMAN_H_INCLUDED
 
+#include <array>
 #include <cstdint>
+#include <string>
 
 #include "misc.h"
 
@@ -32,6 +34,40 @@ namespace Search {
 struct LimitsType;
 }
 
+// The TimeModel is a table of multipliers of the times computed by the formulas
+// of TimeManagement, fitted offline from self-play games (--bench timeplay and
+// --bench timefit). The optimum time of a move is scaled according to the time
+// control, the game ply and the ratio of our clock to the opponent's, the time
+// allowed after each iteration according to the best move changes and the
+// share of the nodes spent on the best move. A cell left at 1, and the whole
+// table by default, keeps the formulas as they are.
+class TimeModel {
+   public:
+    // Upper bounds of the buckets of each key, the last bucket is unbounded
+    static constexpr std::array<double, 5> TimeControls = {30, 120, 300, 900, 2700};  // s
+    static constexpr std::array<double, 5> Plies        = {20, 40, 60, 90, 130};
+    static constexpr std::array<double, 4> ClockRatios  = {0.5, 0.8, 1.25, 2};
+    static constexpr std::array<double, 4> Changes      = {0.25, 0.75, 1.5, 3};  // Per thread
+    static constexpr std::array<double, 4> Efforts      = {30, 50, 70, 90};      // % of nodes
+
+    static constexpr int OptimumCells   = 6 * 6 * 5;
+    static constexpr int IterationCells = 5 * 5;
+
+    // Cells of the keys, gameTime being our clock plus 40 increments at the
+    // first move of the game
+    static int optimum_cell(TimePoint gameTime, int ply, TimePoint ours, TimePoint theirs);
+    static int iteration_cell(double bestMoveChanges, double effort);
+
+    void reset();
+    bool load(const std::string& path);  // On failure, the table is reset
+    bool save(const std::string& path) const;
+
+    std::array<double, OptimumCells>   optimum;
+    std::array<double, IterationCells> iteration;
+
+    TimeModel() { reset(); }
+};
+
 // The TimeManagement class computes the optimal time to think depending on
 // the maximum available time, the game move number, and other parameters.
 class TimeManagement {
@@ -40,10 +76,14 @@ class TimeManagement {
               Color               us,
               int                 ply,
               const OptionsMap&   options,
+              const TimeModel&    model,
               double&             originalTimeAdjust);
 
     TimePoint optimum() const;
     TimePoint maximum() const;
+
+    // Multiplier of the time allowed after an iteration, recording its cell
+    double iteration_scale(double bestMoveChanges, double effort);
     template<typename FUNC>
     TimePoint elapsed(FUNC nodes) const {
         return useNodesTime ? TimePoint(nodes()) : elapsed_time();
@@ -53,10 +93,15 @@ class TimeManagement {
     void clear();
     void advance_nodes_time(std::int64_t nodes);
 
+    // Cells of the time model used by the last search, -1 when not used
+    int optimumCell = -1, iterationCell = -1;
+
    private:
-    TimePoint startTime;
-    TimePoint optimumTime;
-    TimePoint maximumTime;
+    TimePoint        startTime;
+    TimePoint        optimumTime;
+    TimePoint        maximumTime;
+    TimePoint        gameTime = 0;  // Our clock plus 40 increments at the first move
+    const TimeModel* model    = nullptr;
 
     std::int64_t availableNodes = -1;     // When in 'nodes as time' mode
     bool         useNodesTime   = false;  // True if we are in 'nodes as time' mode
@@ -0,0 +1,307 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "trace.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+#include "misc.h"
+
+#if !defined(_WIN32)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+namespace Stockfish::Trace {
+
+namespace {
+
+constexpr char Magic[8] = "SFTRACE";
+
+struct Header {
+    char          magic[8];
+    std::uint32_t recordSize;
+    std::uint32_t unused;
+    std::uint64_t capacity;
+    std::uint64_t count;
+};
+
+// The records start on their own cache line
+constexpr std::size_t RecordsOffset = 64;
+
+constexpr std::size_t FileSize = RecordsOffset + Recorder::Capacity * sizeof(Record);
+
+static_assert(sizeof(Header) <= RecordsOffset);
+
+struct DepthStats {
+    std::uint64_t nodes = 0, ttHits = 0, cutoffs = 0, interior = 0, children = 0;
+    std::uint64_t reduced = 0, reductions = 0, researched = 0, waste = 0;
+};
+
+struct IterationStats {
+    std::uint64_t nodes = 0, windows = 0, waste = 0;
+};
+
+// Walks the records of one thread. A record closes the subtree made of the
+// records since the previous one at the same or a lower ply, so the size of
+// every subtree is known when its root is read. A node followed by a sibling
+// with the same move was searched again, and its subtree was wasted, less the
+// waste already counted inside it.
+class Walker {
+   public:
+    Walker(std::map<int, DepthStats>& d, std::map<int, IterationStats>& i) :
+        depths(d),
+        iterations(i) {}
+
+    void add(const Record& r) {
+
+        if (r.search != search)
+        {
+            search = r.search;
+            subtrees.fill(0);
+            children.fill(0);
+            wasted.fill(0);
+            for (auto& s : siblings)
+                s.valid = false;
+        }
+
+        const int     ply   = r.ply;
+        std::uint64_t size  = 1 + subtrees[ply + 1];
+        std::uint64_t waste = wasted[ply + 1];
+
+        DepthStats& ds = depths[std::max(int(r.depth), 0)];
+        ds.nodes++;
+        ds.ttHits += bool(r.flags & TtHit);
+        ds.cutoffs += bool(r.flags & Cutoff);
+        if (children[ply + 1])
+        {
+            ds.interior++;
+            ds.children += children[ply + 1];
+        }
+        if (r.reduction > 0)
+        {
+            DepthStats& full = depths[std::max(r.depth + r.reduction, 0)];
+            full.reduced++;
+            full.reductions += r.reduction;
+        }
+
+        IterationStats& is = iterations[r.rootDepth];
+        is.nodes++;
+        is.windows += bool(r.flags & RootNode);
+
+        Sibling& previous = siblings[ply];
+        if (previous.valid && previous.move == r.move && previous.rootDepth == r.rootDepth)
+        {
+            ds.waste += previous.size - previous.waste;
+            is.waste += previous.size - previous.waste;
+            wasted[ply] += previous.size - previous.waste;
+            if (previous.reduction > 0)
+                depths[std::max(previous.depth + previous.reduction, 0)].researched++;
+        }
+
+        previous = {true, r.move, r.rootDepth, r.depth, r.reduction, size, waste};
+
+        subtrees[ply + 1] = children[ply + 1] = wasted[ply + 1] = 0;
+        siblings[ply + 1].valid                                  = false;
+        subtrees[ply] += size;
+        wasted[ply] += waste;
+        children[ply]++;
+    }
+
+   private:
+    struct Sibling {
+        bool          valid;
+        std::uint16_t move;
+        std::uint8_t  rootDepth;
+        int           depth, reduction;
+        std::uint64_t size, waste;
+    };
+
+    static constexpr std::size_t Plies = 258;
+
+    std::map<int, DepthStats>&       depths;
+    std::map<int, IterationStats>&   iterations;
+    int                              search = -1;
+    std::array<std::uint64_t, Plies> subtrees{}, children{}, wasted{};
+    std::array<Sibling, Plies>       siblings{};
+};
+
+// Reads the records of a trace file, oldest first, or nothing if the file is
+// not a trace. The records of the nodes whose subtree was overwritten in the
+// ring are skipped, up to the end of the first root search.
+std::vector<Record> read(const std::string& path) {
+
+    std::ifstream file(path, std::ios::binary);
+    Header        header{};
+
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || std::memcmp(header.magic, Magic, sizeof(Magic)) != 0
+        || header.recordSize != sizeof(Record) || !header.capacity)
+        return {};
+
+    std::vector<Record> ring(std::min(header.count, header.capacity));
+    file.seekg(RecordsOffset);
+    file.read(reinterpret_cast<char*>(ring.data()), std::streamsize(ring.size() * sizeof(Record)));
+    ring.resize(std::size_t(file.gcount()) / sizeof(Record));
+
+    if (header.count <= header.capacity)
+        return ring;
+
+    std::vector<Record> records;
+    records.reserve(ring.size());
+
+    std::size_t first = header.count % header.capacity;
+    bool        whole = false;
+
+    for (std::size_t i = 0; i < ring.size(); ++i)
+    {
+        const Record& r = ring[(first + i) % ring.size()];
+        if (whole)
+            records.push_back(r);
+        whole |= r.ply == 0;
+    }
+
+    return records;
+}
+
+}  // namespace
+
+#if !defined(_WIN32)
+
+bool Recorder::open(const std::string& path) {
+
+    if (path == filePath)
+        return is_open() || path.empty();
+
+    close();
+    if (path.empty())
+        return true;
+
+    int fd = ::open(path.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+    if (fd == -1)
+        return false;
+
+    if (ftruncate(fd, FileSize) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void* m = mmap(nullptr, FileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (m == MAP_FAILED)
+        return false;
+
+    Header* header = static_cast<Header*>(m);
+    std::memcpy(header->magic, Magic, sizeof(Magic));
+    header->recordSize = sizeof(Record);
+    header->capacity   = Capacity;
+    header->count      = 0;
+
+    mapped   = m;
+    count    = &header->count;
+    records  = reinterpret_cast<Record*>(static_cast<char*>(m) + RecordsOffset);
+    filePath = path;
+    return true;
+}
+
+void Recorder::close() {
+
+    if (mapped)
+        munmap(mapped, FileSize);
+
+    mapped = nullptr, count = nullptr, records = nullptr;
+    filePath.clear();
+}
+
+#else
+
+bool Recorder::open(const std::string& path) { return path.empty(); }
+void Recorder::close() {}
+
+#endif
+
+void report(const std::vector<std::string>& paths) {
+
+    std::map<int, DepthStats>     depths;
+    std::map<int, IterationStats> iterations;
+    std::uint64_t                 total = 0;
+
+    for (const auto& path : paths)
+    {
+        std::vector<Record> records = read(path);
+        if (records.empty())
+        {
+            sync_cout << "No trace in " << path << sync_endl;
+            continue;
+        }
+
+        Walker walker(depths, iterations);
+        for (const Record& r : records)
+            walker.add(r);
+
+        total += records.size();
+        sync_cout << path << ": " << records.size() << " nodes" << sync_endl;
+    }
+
+    if (!total)
+        return;
+
+    auto percent = [](std::uint64_t n, std::uint64_t d) {
+        return d ? 100.0 * double(n) / double(d) : 0.0;
+    };
+
+    sync_cout << std::fixed << std::setprecision(2)
+              << "\nIteration       nodes   EBF  windows  waste %" << sync_endl;
+
+    std::uint64_t previous = 0;
+    for (const auto& [depth, is] : iterations)
+    {
+        sync_cout << std::setw(9) << depth << std::setw(12) << is.nodes << std::setw(6)
+                  << (previous ? double(is.nodes) / double(previous) : 0.0) << std::setw(9)
+                  << is.windows << std::setw(9) << percent(is.waste, is.nodes) << sync_endl;
+        previous = is.nodes;
+    }
+
+    sync_cout << "\nDepth       nodes  tt hit %  cutoff %  children  reduced  avg r  re-searched %"
+                 "  waste %"
+              << sync_endl;
+
+    for (auto it = depths.rbegin(); it != depths.rend(); ++it)
+    {
+        const auto& [depth, ds] = *it;
+        sync_cout << std::setw(5) << (depth ? std::to_string(depth) : std::string("qs"))
+                  << std::setw(12) << ds.nodes << std::setw(10) << percent(ds.ttHits, ds.nodes)
+                  << std::setw(10) << percent(ds.cutoffs, ds.nodes) << std::setw(10)
+                  << (ds.interior ? double(ds.children) / double(ds.interior) : 0.0)
+                  << std::setw(9) << ds.reduced << std::setw(7)
+                  << (ds.reduced ? double(ds.reductions) / double(ds.reduced) : 0.0)
+                  << std::setw(15) << percent(ds.researched, ds.reduced) << std::setw(9)
+                  << percent(ds.waste, total) << sync_endl;
+    }
+}
+
+}  // namespace Stockfish::Trace
@@ -0,0 +1,88 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Search tree traces, recorded by the builds with "make trace=yes"
+
+#ifndef TRACE_H_INCLUDED
+#define TRACE_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Stockfish::Trace {
+
+enum Flags : std::uint8_t {
+    PvNode      = 1,
+    RootNode    = 2,
+    QsearchNode = 4,
+    CutNode     = 8,
+    TtHit       = 16,
+    Cutoff      = 32  // The node failed high
+};
+
+// One searched node, written when its search returns, so that the nodes of a
+// subtree are followed by its root. Depth is zero in qsearch, reduction is the
+// LMR reduction the parent searched the node with.
+struct Record {
+    std::uint16_t search;  // Number of the "go" in the thread, wrapping
+    std::uint16_t move;    // Move leading to the node
+    std::int16_t  alpha, beta, value;
+    std::int8_t   depth, reduction;
+    std::uint8_t  ply, rootDepth, flags, unused;
+};
+
+static_assert(sizeof(Record) == 16);
+
+// The trace of one search thread, a ring of records in a memory-mapped file,
+// which keeps the last Capacity nodes when the search outgrows it. The file is
+// valid at any time, also when the engine is killed while searching.
+class Recorder {
+   public:
+    static constexpr std::size_t Capacity = 1 << 22;  // 64 MiB per thread
+
+    Recorder() = default;
+    Recorder(const Recorder&) = delete;
+    ~Recorder() { close(); }
+
+    // Maps the given file, if not mapped yet, or unmaps the file if the path is
+    // empty. Returns false if the file can not be created.
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const { return records != nullptr; }
+
+    void record(const Record& r) { records[(*count)++ & (Capacity - 1)] = r; }
+
+   private:
+    std::string    filePath;
+    void*          mapped  = nullptr;
+    std::uint64_t* count   = nullptr;  // Records written, in the file header
+    Record*        records = nullptr;
+};
+
+// Reads the trace files of the given paths, one per thread, and prints the nodes
+// and effective branching factor of each iteration, then per depth the children
+// searched per node, the LMR reductions and how many of them were re-searched,
+// and the nodes spent in searches that were repeated at a higher depth or with a
+// wider window.
+void report(const std::vector<std::string>& paths);
+
+}  // namespace Stockfish::Trace
+
+#endif  // #ifndef TRACE_H_INCLUDED
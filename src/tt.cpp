@@ -18,6 +18,7 @@
 
 #include "tt.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <cstdlib>
@@ -62,6 +63,7 @@ struct TTEntry {
 
    private:
     friend class TranspositionTable;
+    friend struct TTWriter;
 
     uint16_t key16;
     uint8_t  depth8;
@@ -126,12 +128,74 @@ uint8_t TTEntry::relative_age(const uint8_t generation8) const {
 
 
 // TTWriter is but a very thin wrapper around the pointer
-TTWriter::TTWriter(TTEntry* tte) :
-    entry(tte) {}
+TTWriter::TTWriter(
+  TTEntry* tte, TTLog* ttLog, TTCounters* ttCounters, TTFront* ttFront, bool isPending) :
+    entry(tte),
+    log(ttLog),
+    counters(ttCounters),
+    front(ttFront),
+    pending(isPending) {}
 
 void TTWriter::write(
   Key k, Value v, bool pv, Bound b, Depth d, Move m, Value ev, uint8_t generation8) {
+
+    if (pending)
+    {
+        entry   = locate(entry, uint16_t(k), generation8);
+        pending = false;
+    }
+
+    if (counters)
+    {
+        counters->writes++;
+        if (entry->is_occupied() && entry->key16 != uint16_t(k))
+        {
+            counters->replaced++;
+            counters->replacedCurrent += !entry->relative_age(generation8);
+        }
+    }
+
+    if (log)
+    {
+        log->writes.push_back({entry, k, v, ev, d, m, b, pv, generation8});
+        log->recent[k & (TTLog::RecentSize - 1)] = uint32_t(log->writes.size());
+        return;
+    }
+
     entry->save(k, v, pv, b, d, m, ev, generation8);
+
+    // Unless another thread wrote another position in between
+    if (front && entry->key16 == uint16_t(k))
+        front->update(k, entry->read());
+}
+
+
+void TTFront::update(Key key, const TTData& data) {
+
+    Entry& e = slot(key);
+
+    if (data.depth <= MaxDepth)
+        e = {key,
+             data.move,
+             int16_t(data.value),
+             int16_t(data.eval),
+             int8_t(data.depth),
+             uint8_t(data.bound | data.is_pv << 2)};
+
+    // A deeper entry of the key would be shadowed by the shallower one
+    else if (e.key == key)
+        e.key = 0;
+}
+
+
+void TTLog::apply() {
+    for (const Write& w : writes)
+    {
+        w.entry->save(w.key, w.value, w.pv, w.bound, w.depth, w.move, w.eval, w.generation8);
+        recent[w.key & (RecentSize - 1)] = 0;
+    }
+
+    writes.clear();
 }
 
 
@@ -222,27 +286,103 @@ uint8_t TranspositionTable::generation() const { return generation8; }
 // to be replaced later. The replace value of an entry is calculated as its depth
 // minus 8 times its relative age. TTEntry t1 is considered more valuable than
 // TTEntry t2 if its replace value is greater than that of t2.
-std::tuple<bool, TTData, TTWriter> TranspositionTable::probe(const Key key) const {
+std::tuple<bool, TTData, TTWriter>
+TranspositionTable::probe(const Key key, TTLog* log, TTCounters* counters, TTFront* front) const {
+
+    if (counters)
+        counters->probes++;
+
+    // A write still held back in the log of this thread is newer than the table
+    if (log)
+        if (uint32_t i = log->recent[key & (TTLog::RecentSize - 1)];
+            i && log->writes[i - 1].key == key)
+        {
+            const TTLog::Write& w = log->writes[i - 1];
+            if (counters)
+                counters->hits++;
+            return {true, TTData{w.move, w.value, w.eval, w.depth, w.bound, w.pv},
+                    TTWriter(w.entry, log, counters, nullptr, false)};
+        }
+
+    // The cluster is only looked up when the entry is written
+    if (front)
+        if (const TTFront::Entry& e = front->slot(key); e.key == key)
+        {
+            if (counters)
+                counters->hits++, counters->frontHits++;
+            return {true,
+                    TTData{e.move, Value(e.value), Value(e.eval), Depth(e.depth),
+                           Bound(e.boundPv & 0x3), bool(e.boundPv & 0x4)},
+                    TTWriter(first_entry(key), log, counters, front, true)};
+        }
+
+    TTEntry* const cluster = first_entry(key);
+    const uint16_t key16   = uint16_t(key);  // Use the low 16 bits as key inside the cluster
+    TTEntry* const tte     = TTWriter::locate(cluster, key16, generation8);
+
+    if (tte->key16 == key16)
+    {
+        if (counters)
+            counters->hits += tte->is_occupied();
+        // This gap is the main place for read races.
+        // After `read()` completes that copy is final, but may be self-inconsistent.
+        const TTData data = tte->read();
+        if (front && tte->is_occupied())
+            front->update(key, data);
+        return {tte->is_occupied(), data, TTWriter(tte, log, counters, front, false)};
+    }
+
+    if (counters)
+        for (int i = 0; i < ClusterSize; ++i)
+            counters->missOccupancy += cluster[i].is_occupied();
+
+    return {false,
+            TTData{Move::none(), VALUE_NONE, VALUE_NONE, DEPTH_ENTRY_OFFSET, BOUND_NONE, false},
+            TTWriter(tte, log, counters, front, false)};
+}
 
-    TTEntry* const tte   = first_entry(key);
-    const uint16_t key16 = uint16_t(key);  // Use the low 16 bits as key inside the cluster
+
+// Returns the entry of the cluster holding the key, or else the one to be replaced by
+// the write, chosen as described at probe().
+TTEntry* TTWriter::locate(TTEntry* cluster, uint16_t key16, uint8_t generation8) {
 
     for (int i = 0; i < ClusterSize; ++i)
-        if (tte[i].key16 == key16)
-            // This gap is the main place for read races.
-            // After `read()` completes that copy is final, but may be self-inconsistent.
-            return {tte[i].is_occupied(), tte[i].read(), TTWriter(&tte[i])};
+        if (cluster[i].key16 == key16)
+            return &cluster[i];
 
     // Find an entry to be replaced according to the replacement strategy
-    TTEntry* replace = tte;
+    TTEntry* replace = cluster;
     for (int i = 1; i < ClusterSize; ++i)
         if (replace->depth8 - replace->relative_age(generation8)
-            > tte[i].depth8 - tte[i].relative_age(generation8))
-            replace = &tte[i];
+            > cluster[i].depth8 - cluster[i].relative_age(generation8))
+            replace = &cluster[i];
 
-    return {false,
-            TTData{Move::none(), VALUE_NONE, VALUE_NONE, DEPTH_ENTRY_OFFSET, BOUND_NONE, false},
-            TTWriter(replace)};
+    return replace;
+}
+
+
+// Counts the entries of the first clusters by their contents. As the clusters of
+// the positions are spread evenly, any number of them is a fair sample.
+TTOccupancy TranspositionTable::occupancy(size_t maxClusters) const {
+
+    TTOccupancy  o;
+    const size_t count = maxClusters ? std::min(maxClusters, clusterCount) : clusterCount;
+
+    for (size_t i = 0; i < count; ++i)
+        for (const TTEntry& e : table[i].entry)
+        {
+            o.entries++;
+            if (!e.is_occupied())
+                continue;
+
+            o.occupied++;
+            o.pv += bool(e.genBound8 & 0x4);
+            o.bound[e.genBound8 & 0x3]++;
+            o.age[e.relative_age(generation8) >> GENERATION_BITS]++;
+            o.depth[e.depth8]++;
+        }
+
+    return o;
 }
 
 
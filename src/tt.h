@@ -19,9 +19,11 @@
 #ifndef TT_H_INCLUDED
 #define TT_H_INCLUDED
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <tuple>
+#include <vector>
 
 #include "memory.h"
 #include "types.h"
@@ -29,6 +31,9 @@
 namespace Stockfish {
 
 class ThreadPool;
+class TTLog;
+class TTFront;
+struct TTCounters;
 struct TTEntry;
 struct Cluster;
 
@@ -66,15 +71,105 @@ struct TTData {
 };
 
 
-// This is used to make racy writes to the global TT.
+// This is used to make racy writes to the global TT, or to log them when probed with a TTLog.
 struct TTWriter {
    public:
     void write(Key k, Value v, bool pv, Bound b, Depth d, Move m, Value ev, uint8_t generation8);
 
    private:
     friend class TranspositionTable;
-    TTEntry* entry;
-    TTWriter(TTEntry* tte);
+    TTEntry*    entry;  // Or the first entry of its cluster while pending
+    TTLog*      log;
+    TTCounters* counters;
+    TTFront*    front;
+    bool        pending;  // Found in the front table, the entry is looked up by the first write
+    TTWriter(TTEntry* tte, TTLog* ttLog, TTCounters* ttCounters, TTFront* ttFront, bool isPending);
+
+    // The entry of the cluster holding the key, or else the one to replace
+    static TTEntry* locate(TTEntry* cluster, uint16_t key16, uint8_t generation8);
+};
+
+
+// Recent shallow entries of one search thread, few enough to stay in its L2 cache, probed
+// before the table. Most probes are of shallow nodes revisited soon after their entry was
+// written, which then wait for the cache instead of memory. Writes go to both tables. The
+// entries written by the other threads are only seen once the front entry is replaced.
+class TTFront {
+   public:
+    static constexpr size_t Size     = 1 << 14;  // 256 KB
+    static constexpr Depth  MaxDepth = 4;        // Deeper nodes are rare, their probes cheap
+
+    void clear() { table.fill({}); }
+
+   private:
+    friend class TranspositionTable;
+    friend struct TTWriter;
+
+    struct Entry {
+        Key     key;
+        Move    move;
+        int16_t value, eval;
+        int8_t  depth;
+        uint8_t boundPv;
+    };
+
+    static_assert(sizeof(Entry) == 16, "Four entries per cache line");
+
+    Entry& slot(Key key) { return table[key & (Size - 1)]; }
+    void   update(Key key, const TTData& data);
+
+    alignas(64) std::array<Entry, Size> table;
+};
+
+
+// The probes and writes of one search thread, counted when probed with them. A write replaces
+// an entry when it stores another position in an occupied one.
+struct TTCounters {
+    uint64_t probes = 0, hits = 0, frontHits = 0, writes = 0;
+    uint64_t replaced = 0, replacedCurrent = 0;  // The latter of entries of the current search
+    uint64_t missOccupancy = 0;  // Occupied entries of the clusters of the probes that missed
+
+    // Estimated number of false hits. A probe of a position that is not in the table matches
+    // the 16-bit key of each occupied entry of its cluster with a chance of 1 in 65536.
+    double collisions() const { return double(missOccupancy) / 65536; }
+};
+
+
+// The entries of the table, or of a sample of it, by their contents
+struct TTOccupancy {
+    uint64_t                  entries = 0, occupied = 0, pv = 0;
+    std::array<uint64_t, 4>   bound{};  // Of the occupied entries, by Bound
+    std::array<uint64_t, 32>  age{};    // By searches since the write, modulo 32
+    std::array<uint64_t, 256> depth{};  // By depth - DEPTH_ENTRY_OFFSET
+};
+
+
+// The writes of a thread in the deterministic search mode. They are held back and applied to
+// the table by the thread pool, in thread order, at points that every thread reaches after
+// the same number of nodes in every run. Probes with the log see its latest write of a key.
+class TTLog {
+   public:
+    void apply();  // Saves the writes to the table and empties the log
+
+   private:
+    friend class TranspositionTable;
+    friend struct TTWriter;
+
+    static constexpr size_t RecentSize = 4096;
+
+    struct Write {
+        TTEntry* entry;
+        Key      key;
+        Value    value, eval;
+        Depth    depth;
+        Move     move;
+        Bound    bound;
+        bool     pv;
+        uint8_t  generation8;
+    };
+
+    std::vector<Write>    writes;
+    std::vector<uint32_t> recent = std::vector<uint32_t>(RecentSize);  // 1 + index into writes
 };
 
 
@@ -92,9 +187,14 @@ class TranspositionTable {
     new_search();  // This must be called at the beginning of each root search to track entry aging
     uint8_t generation() const;  // The current age, used when writing new data to the TT
     std::tuple<bool, TTData, TTWriter>
-    probe(const Key key) const;  // The main method, whose retvals separate local vs global objects
+    probe(const Key   key,
+          TTLog*      log      = nullptr,
+          TTCounters* counters = nullptr,
+          TTFront*    front    = nullptr) const;  // The main method, whose retvals separate local vs global objects
     TTEntry* first_entry(const Key key)
       const;  // This is the hash function; its only external use is memory prefetching.
+    TTOccupancy occupancy(size_t maxClusters = 0)
+      const;  // Counts the entries of the first clusters, all with 0. Racy while searching.
 
    private:
     friend struct TTEntry;